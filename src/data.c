@@ -10,34 +10,123 @@ static unsigned char const bt_glyph3d_vertex_spirv_bytes[] = {
 static unsigned char const bt_glyph_fragment_spirv_bytes[] = {
 #embed <glyph.frag.spv>
 };
-static alignas(alignof(struct bt_font_curve)) unsigned char const bt_font_curve_bytes[] = {
-#embed <glyph_buffer.data>
+static unsigned char const bt_glyph_dual_axis_fragment_spirv_bytes[] = {
+#embed <glyph_dual_axis.frag.spv>
 };
-static alignas(alignof(struct bt_font_curve_info)) unsigned char const bt_font_curve_info_bytes[] = {
-#embed <info_buffer.data>
+static unsigned char const bt_glyph_fp16_fragment_spirv_bytes[] = {
+#embed <glyph_fp16.frag.spv>
 };
-static alignas(alignof(struct bt_font_metrics)) unsigned char const bt_font_metrics_bytes[] = {
-#embed <metrics_buffer.data>
+static unsigned char const bt_glyph_fp16_aliased_fragment_spirv_bytes[] = {
+#embed <glyph_fp16_aliased.frag.spv>
+};
+static unsigned char const bt_glyph_linear_fragment_spirv_bytes[] = {
+#embed <glyph_linear.frag.spv>
+};
+static unsigned char const bt_glyph_atlas_vertex_spirv_bytes[] = {
+#embed <glyph_atlas.vert.spv>
+};
+static unsigned char const bt_glyph_atlas_fragment_spirv_bytes[] = {
+#embed <glyph_atlas.frag.spv>
+};
+static unsigned char const bt_glyph_alpha_to_coverage_fragment_spirv_bytes[] = {
+#embed <glyph_alpha_to_coverage.frag.spv>
+};
+static unsigned char const bt_glyph_heatmap_fragment_spirv_bytes[] = {
+#embed <glyph_heatmap.frag.spv>
+};
+static unsigned char const bt_glyph_dual_axis_heatmap_fragment_spirv_bytes[] = {
+#embed <glyph_dual_axis_heatmap.frag.spv>
+};
+static unsigned char const bt_text2d_composite_vertex_spirv_bytes[] = {
+#embed <text2d_composite.vert.spv>
+};
+static unsigned char const bt_text2d_composite_fragment_spirv_bytes[] = {
+#embed <text2d_composite.frag.spv>
+};
+static unsigned char const bt_text2d_bin_compute_spirv_bytes[] = {
+#embed <text2d_bin.comp.spv>
+};
+static unsigned char const bt_text2d_tiles_compute_spirv_bytes[] = {
+#embed <text2d_tiles.comp.spv>
+};
+static unsigned char const bt_glyph_texture_fragment_spirv_bytes[] = {
+#embed <glyph_texture.frag.spv>
+};
+static unsigned char const bt_glyph_dual_axis_texture_fragment_spirv_bytes[] = {
+#embed <glyph_dual_axis_texture.frag.spv>
+};
+static unsigned char const bt_glyph_alpha_to_coverage_texture_fragment_spirv_bytes[] = {
+#embed <glyph_alpha_to_coverage_texture.frag.spv>
+};
+static unsigned char const bt_glyph_atlas_texture_fragment_spirv_bytes[] = {
+#embed <glyph_atlas_texture.frag.spv>
+};
+static unsigned char const bt_text2d_tiles_texture_compute_spirv_bytes[] = {
+#embed <text2d_tiles_texture.comp.spv>
 };
 
 uint32_t const *const bt_glyph2d_vertex_spirv = (uint32_t const *)bt_glyph2d_vertex_spirv_bytes;
 uint32_t const *const bt_glyph3d_vertex_spirv = (uint32_t const *)bt_glyph3d_vertex_spirv_bytes;
 uint32_t const *const bt_glyph_fragment_spirv = (uint32_t const *)bt_glyph_fragment_spirv_bytes;
-struct bt_font_curve const *const bt_font_curves = (struct bt_font_curve const *)bt_font_curve_bytes;
-struct bt_font_curve_info const *const bt_font_curve_infos = (struct bt_font_curve_info const *)bt_font_curve_info_bytes;
-struct bt_font_metrics const *const bt_font_metrics = (struct bt_font_metrics const *)bt_font_metrics_bytes;
+uint32_t const *const bt_glyph_dual_axis_fragment_spirv = (uint32_t const *)bt_glyph_dual_axis_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_fp16_fragment_spirv = (uint32_t const *)bt_glyph_fp16_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_fp16_aliased_fragment_spirv = (uint32_t const *)bt_glyph_fp16_aliased_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_linear_fragment_spirv = (uint32_t const *)bt_glyph_linear_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_atlas_vertex_spirv = (uint32_t const *)bt_glyph_atlas_vertex_spirv_bytes;
+uint32_t const *const bt_glyph_atlas_fragment_spirv = (uint32_t const *)bt_glyph_atlas_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_alpha_to_coverage_fragment_spirv = (uint32_t const *)bt_glyph_alpha_to_coverage_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_heatmap_fragment_spirv = (uint32_t const *)bt_glyph_heatmap_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_dual_axis_heatmap_fragment_spirv = (uint32_t const *)bt_glyph_dual_axis_heatmap_fragment_spirv_bytes;
+uint32_t const *const bt_text2d_composite_vertex_spirv = (uint32_t const *)bt_text2d_composite_vertex_spirv_bytes;
+uint32_t const *const bt_text2d_composite_fragment_spirv = (uint32_t const *)bt_text2d_composite_fragment_spirv_bytes;
+uint32_t const *const bt_text2d_bin_compute_spirv = (uint32_t const *)bt_text2d_bin_compute_spirv_bytes;
+uint32_t const *const bt_text2d_tiles_compute_spirv = (uint32_t const *)bt_text2d_tiles_compute_spirv_bytes;
+uint32_t const *const bt_glyph_texture_fragment_spirv = (uint32_t const *)bt_glyph_texture_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_dual_axis_texture_fragment_spirv = (uint32_t const *)bt_glyph_dual_axis_texture_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_alpha_to_coverage_texture_fragment_spirv = (uint32_t const *)bt_glyph_alpha_to_coverage_texture_fragment_spirv_bytes;
+uint32_t const *const bt_glyph_atlas_texture_fragment_spirv = (uint32_t const *)bt_glyph_atlas_texture_fragment_spirv_bytes;
+uint32_t const *const bt_text2d_tiles_texture_compute_spirv = (uint32_t const *)bt_text2d_tiles_texture_compute_spirv_bytes;
 
 uint32_t const bt_glyph2d_vertex_spirv_byte_size = sizeof(bt_glyph2d_vertex_spirv_bytes);
 uint32_t const bt_glyph3d_vertex_spirv_byte_size = sizeof(bt_glyph3d_vertex_spirv_bytes);
 uint32_t const bt_glyph_fragment_spirv_byte_size = sizeof(bt_glyph_fragment_spirv_bytes);
-uint32_t const bt_font_curves_byte_size = sizeof(bt_font_curve_bytes);
-uint32_t const bt_font_curve_infos_byte_size = sizeof(bt_font_curve_info_bytes);
-uint32_t const bt_font_metrics_byte_size = sizeof(bt_font_metrics_bytes);
+uint32_t const bt_glyph_dual_axis_fragment_spirv_byte_size = sizeof(bt_glyph_dual_axis_fragment_spirv_bytes);
+uint32_t const bt_glyph_fp16_fragment_spirv_byte_size = sizeof(bt_glyph_fp16_fragment_spirv_bytes);
+uint32_t const bt_glyph_fp16_aliased_fragment_spirv_byte_size = sizeof(bt_glyph_fp16_aliased_fragment_spirv_bytes);
+uint32_t const bt_glyph_linear_fragment_spirv_byte_size = sizeof(bt_glyph_linear_fragment_spirv_bytes);
+uint32_t const bt_glyph_atlas_vertex_spirv_byte_size = sizeof(bt_glyph_atlas_vertex_spirv_bytes);
+uint32_t const bt_glyph_atlas_fragment_spirv_byte_size = sizeof(bt_glyph_atlas_fragment_spirv_bytes);
+uint32_t const bt_glyph_alpha_to_coverage_fragment_spirv_byte_size = sizeof(bt_glyph_alpha_to_coverage_fragment_spirv_bytes);
+uint32_t const bt_glyph_heatmap_fragment_spirv_byte_size = sizeof(bt_glyph_heatmap_fragment_spirv_bytes);
+uint32_t const bt_glyph_dual_axis_heatmap_fragment_spirv_byte_size = sizeof(bt_glyph_dual_axis_heatmap_fragment_spirv_bytes);
+uint32_t const bt_text2d_composite_vertex_spirv_byte_size = sizeof(bt_text2d_composite_vertex_spirv_bytes);
+uint32_t const bt_text2d_composite_fragment_spirv_byte_size = sizeof(bt_text2d_composite_fragment_spirv_bytes);
+uint32_t const bt_text2d_bin_compute_spirv_byte_size = sizeof(bt_text2d_bin_compute_spirv_bytes);
+uint32_t const bt_text2d_tiles_compute_spirv_byte_size = sizeof(bt_text2d_tiles_compute_spirv_bytes);
+uint32_t const bt_glyph_texture_fragment_spirv_byte_size = sizeof(bt_glyph_texture_fragment_spirv_bytes);
+uint32_t const bt_glyph_dual_axis_texture_fragment_spirv_byte_size = sizeof(bt_glyph_dual_axis_texture_fragment_spirv_bytes);
+uint32_t const bt_glyph_alpha_to_coverage_texture_fragment_spirv_byte_size = sizeof(bt_glyph_alpha_to_coverage_texture_fragment_spirv_bytes);
+uint32_t const bt_glyph_atlas_texture_fragment_spirv_byte_size = sizeof(bt_glyph_atlas_texture_fragment_spirv_bytes);
+uint32_t const bt_text2d_tiles_texture_compute_spirv_byte_size = sizeof(bt_text2d_tiles_texture_compute_spirv_bytes);
 
 uint32_t const bt_glyph2d_vertex_spirv_len = bt_glyph2d_vertex_spirv_byte_size / sizeof(*bt_glyph2d_vertex_spirv);
 uint32_t const bt_glyph3d_vertex_spirv_len = bt_glyph3d_vertex_spirv_byte_size / sizeof(*bt_glyph3d_vertex_spirv);
 uint32_t const bt_glyph_fragment_spirv_len = bt_glyph_fragment_spirv_byte_size / sizeof(*bt_glyph_fragment_spirv);
-uint32_t const bt_font_curves_len = bt_font_curves_byte_size / sizeof(*bt_font_curves);
-uint32_t const bt_font_curve_infos_len = bt_font_curve_infos_byte_size / sizeof(*bt_font_curve_infos);
-uint32_t const bt_font_metrics_len = bt_font_metrics_byte_size / sizeof(*bt_font_metrics);
-
+uint32_t const bt_glyph_dual_axis_fragment_spirv_len = bt_glyph_dual_axis_fragment_spirv_byte_size / sizeof(*bt_glyph_dual_axis_fragment_spirv);
+uint32_t const bt_glyph_fp16_fragment_spirv_len = bt_glyph_fp16_fragment_spirv_byte_size / sizeof(*bt_glyph_fp16_fragment_spirv);
+uint32_t const bt_glyph_fp16_aliased_fragment_spirv_len = bt_glyph_fp16_aliased_fragment_spirv_byte_size / sizeof(*bt_glyph_fp16_aliased_fragment_spirv);
+uint32_t const bt_glyph_linear_fragment_spirv_len = bt_glyph_linear_fragment_spirv_byte_size / sizeof(*bt_glyph_linear_fragment_spirv);
+uint32_t const bt_glyph_atlas_vertex_spirv_len = bt_glyph_atlas_vertex_spirv_byte_size / sizeof(*bt_glyph_atlas_vertex_spirv);
+uint32_t const bt_glyph_atlas_fragment_spirv_len = bt_glyph_atlas_fragment_spirv_byte_size / sizeof(*bt_glyph_atlas_fragment_spirv);
+uint32_t const bt_glyph_alpha_to_coverage_fragment_spirv_len = bt_glyph_alpha_to_coverage_fragment_spirv_byte_size / sizeof(*bt_glyph_alpha_to_coverage_fragment_spirv);
+uint32_t const bt_glyph_heatmap_fragment_spirv_len = bt_glyph_heatmap_fragment_spirv_byte_size / sizeof(*bt_glyph_heatmap_fragment_spirv);
+uint32_t const bt_glyph_dual_axis_heatmap_fragment_spirv_len = bt_glyph_dual_axis_heatmap_fragment_spirv_byte_size / sizeof(*bt_glyph_dual_axis_heatmap_fragment_spirv);
+uint32_t const bt_text2d_composite_vertex_spirv_len = bt_text2d_composite_vertex_spirv_byte_size / sizeof(*bt_text2d_composite_vertex_spirv);
+uint32_t const bt_text2d_composite_fragment_spirv_len = bt_text2d_composite_fragment_spirv_byte_size / sizeof(*bt_text2d_composite_fragment_spirv);
+uint32_t const bt_text2d_bin_compute_spirv_len = bt_text2d_bin_compute_spirv_byte_size / sizeof(*bt_text2d_bin_compute_spirv);
+uint32_t const bt_text2d_tiles_compute_spirv_len = bt_text2d_tiles_compute_spirv_byte_size / sizeof(*bt_text2d_tiles_compute_spirv);
+uint32_t const bt_glyph_texture_fragment_spirv_len = bt_glyph_texture_fragment_spirv_byte_size / sizeof(*bt_glyph_texture_fragment_spirv);
+uint32_t const bt_glyph_dual_axis_texture_fragment_spirv_len = bt_glyph_dual_axis_texture_fragment_spirv_byte_size / sizeof(*bt_glyph_dual_axis_texture_fragment_spirv);
+uint32_t const bt_glyph_alpha_to_coverage_texture_fragment_spirv_len = bt_glyph_alpha_to_coverage_texture_fragment_spirv_byte_size / sizeof(*bt_glyph_alpha_to_coverage_texture_fragment_spirv);
+uint32_t const bt_glyph_atlas_texture_fragment_spirv_len = bt_glyph_atlas_texture_fragment_spirv_byte_size / sizeof(*bt_glyph_atlas_texture_fragment_spirv);
+uint32_t const bt_text2d_tiles_texture_compute_spirv_len = bt_text2d_tiles_texture_compute_spirv_byte_size / sizeof(*bt_text2d_tiles_texture_compute_spirv);
@@ -3,40 +3,218 @@
 
 #include <stdint.h>
 
+/*
+ * Bump whenever the layout of font packs changes. The font compiler
+ * (tools/fontc.c) writes it into every pack and section it produces and the
+ * game refuses to load packs from a different version.
+ */
+constexpr uint32_t bt_font_data_version = 13;
+
+constexpr uint32_t bt_font_data_magic_pack = 0x4B465442;    // "BTFK"
+constexpr uint32_t bt_font_data_magic_curves = 0x43465442;  // "BTFC"
+constexpr uint32_t bt_font_data_magic_infos = 0x49465442;   // "BTFI"
+constexpr uint32_t bt_font_data_magic_metrics = 0x4D465442; // "BTFM"
+constexpr uint32_t bt_font_data_magic_bands = 0x42465442;   // "BTFB"
+constexpr uint32_t bt_font_data_magic_cmap = 0x55465442;    // "BTFU"
+
+/*
+ * A font pack starts with this header, followed by `section_count` sections in
+ * the order curves, curve infos, metrics, bands, cmap. Every section starts at
+ * a multiple of 16 bytes.
+ */
+struct bt_font_pack_header {
+  alignas(16) uint32_t magic;
+  uint32_t version;
+  uint32_t section_count;
+  uint32_t reserved;
+};
+
+constexpr uint32_t bt_font_pack_section_count = 5;
+constexpr uint32_t bt_font_pack_section_alignment = 16;
+
+/*
+ * Every section of a font pack starts with this header, followed by `count`
+ * elements of `element_size` bytes each. The header is 16 bytes so the
+ * elements keep their alignment.
+ */
+struct bt_font_data_header {
+  alignas(16) uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t element_size;
+};
+
+/*
+ * Control points lie on a grid of bt_font_curve_step spanning
+ * [bt_font_curve_min, bt_font_curve_min + bt_font_curve_range) in glyph quad
+ * space, which leaves room for outlines that extend past the quad. Grid values
+ * and their sums are exact floats, so curves sharing an endpoint agree on it
+ * exactly in the fragment shader. The glyph bounds and band entries store grid
+ * positions as uint16.
+ */
+constexpr float bt_font_curve_min = -0.5f;
+constexpr float bt_font_curve_range = 2.0f;
+constexpr float bt_font_curve_step = bt_font_curve_range / 65536.0f;
+
+/*
+ * A quadratic curve from control points p0, p1 and p2, stored as grid
+ * positions. The shaders turn them into the coefficients of
+ * p(t) = a * t^2 - 2 * b * t + c, with a = p0 - 2 * p1 + p2, b = p0 - p1 and
+ * c = p0, which are exact on the grid. Curves are monotonic in x and y, so
+ * horizontal and vertical rays cross each of them at most once.
+ */
 struct bt_font_curve {
-  alignas(16) float p0[2];
-  float p1[2];
-  float p2[2];
+  uint16_t p0[2];
+  uint16_t p1[2];
+  uint16_t p2[2];
 };
 
+/*
+ * Indexed by level of detail times the glyph count, which is the length of the
+ * metrics section, plus the glyph index, see bt_font_lod_count. The curves of
+ * the glyph are in the range [start, end) of the curve section.
+ *
+ * The glyph quad is also split into `band_count` horizontal bands of equal
+ * height. bands[band_start + 2 * i] and bands[band_start + 2 * i + 1] of the
+ * uint32 band section are the start and end of the list of curves crossing
+ * band i, which is also in the band section. The list entries hold the curve
+ * index relative to `start` in their low bt_font_band_index_bits bits, so the
+ * curves of a glyph can be moved as a whole, and the grid position of the
+ * curve's maximum x in the rest. They are sorted by descending maximum x so the
+ * fragment shader can stop once the curves are left of the pixel, without
+ * reading them. Horizontal curves are left out. Every glyph has at least one
+ * band, except composite glyphs.
+ *
+ * The `band_count` pairs after those are the same for vertical bands of equal
+ * width, with the maximum y of the curves instead of x, for the vertical ray of
+ * the dual axis fragment shader. Vertical curves are left out of them.
+ *
+ * The bt_font_grid_words values after the vertical pairs are the glyph's
+ * occupancy grid, which splits its bounds into bt_font_grid_size cells along
+ * each axis. The first two hold the min and max corners of the grid as grid
+ * positions, with x in the low and y in the high 16 bits. Each of the others is
+ * a row of cells, from the top, with bt_font_grid_bits bits per cell from the
+ * left in the low bits: whether the cell is empty, solid or crossed by an edge.
+ * Pixels entirely inside an empty or solid cell don't need the curves.
+ *
+ * Composite glyphs, like most accented letters, reuse the curves of the glyphs
+ * they are made of instead of having their own. They have no curves and a
+ * `band_count` of 0. bands[band_start] is the number of components, followed
+ * by two values per component: its glyph index and its offset from the
+ * composite, as int16 grid steps with x in the low and y in the high 16 bits.
+ * Components are never composite themselves.
+ */
 struct bt_font_curve_info {
   alignas(16) uint32_t start;
-  uint32_t count;
+  uint32_t end;
+  uint32_t band_start;
+  uint32_t band_count;
 };
 
+/*
+ * Every glyph has this many outlines, from the full one at level 0 to ever
+ * simpler ones with fewer curves for drawing it smaller. Each level is a glyph
+ * of its own in the curve info section, with its own curves and bands. The
+ * components of the composite glyphs of a level are glyphs of the same level.
+ */
+constexpr uint32_t bt_font_lod_count = 3;
+
+constexpr uint32_t bt_font_band_index_bits = 16;
+constexpr uint32_t bt_font_band_index_mask =
+    (1u << bt_font_band_index_bits) - 1;
+
+constexpr uint32_t bt_font_grid_size = 16;
+constexpr uint32_t bt_font_grid_bits = 2;
+constexpr uint32_t bt_font_grid_words = 2 + bt_font_grid_size;
+constexpr uint32_t bt_font_grid_empty = 0;
+constexpr uint32_t bt_font_grid_solid = 1;
+constexpr uint32_t bt_font_grid_edge = 2;
+
+/*
+ * Indexed by glyph index. `bounds` is the min x, min y, max x and max y of the
+ * glyph's control points as grid positions. Glyphs without curves have a min
+ * greater than their max.
+ */
 struct bt_font_metrics {
   float advance;
+  uint16_t bounds[4];
 };
 
+/*
+ * The codepoint to glyph index map is a two-level page table of uint32
+ * values. cmap[0] is the number of pages, followed by the offset of each page
+ * in the cmap section. A page holds the glyph indices of
+ * bt_font_cmap_page_size consecutive codepoints. Pages without any glyphs
+ * share one page of zeroes, and glyph 0 is the empty glyph.
+ */
+constexpr uint32_t bt_font_cmap_page_bits = 8;
+constexpr uint32_t bt_font_cmap_page_size = 1u << bt_font_cmap_page_bits;
+
 extern uint32_t const *const bt_glyph2d_vertex_spirv;
 extern uint32_t const *const bt_glyph3d_vertex_spirv;
 extern uint32_t const *const bt_glyph_fragment_spirv;
-extern struct bt_font_curve const *const bt_font_curves;
-extern struct bt_font_curve_info const *const bt_font_curve_infos;
-extern struct bt_font_metrics const *const bt_font_metrics;
+extern uint32_t const *const bt_glyph_dual_axis_fragment_spirv;
+extern uint32_t const *const bt_glyph_fp16_fragment_spirv;
+extern uint32_t const *const bt_glyph_fp16_aliased_fragment_spirv;
+extern uint32_t const *const bt_glyph_linear_fragment_spirv;
+extern uint32_t const *const bt_glyph_atlas_vertex_spirv;
+extern uint32_t const *const bt_glyph_atlas_fragment_spirv;
+extern uint32_t const *const bt_glyph_alpha_to_coverage_fragment_spirv;
+extern uint32_t const *const bt_glyph_heatmap_fragment_spirv;
+extern uint32_t const *const bt_glyph_dual_axis_heatmap_fragment_spirv;
+extern uint32_t const *const bt_text2d_composite_vertex_spirv;
+extern uint32_t const *const bt_text2d_composite_fragment_spirv;
+extern uint32_t const *const bt_text2d_bin_compute_spirv;
+extern uint32_t const *const bt_text2d_tiles_compute_spirv;
+extern uint32_t const *const bt_glyph_texture_fragment_spirv;
+extern uint32_t const *const bt_glyph_dual_axis_texture_fragment_spirv;
+extern uint32_t const *const bt_glyph_alpha_to_coverage_texture_fragment_spirv;
+extern uint32_t const *const bt_glyph_atlas_texture_fragment_spirv;
+extern uint32_t const *const bt_text2d_tiles_texture_compute_spirv;
 
 extern uint32_t const bt_glyph2d_vertex_spirv_byte_size;
 extern uint32_t const bt_glyph3d_vertex_spirv_byte_size;
 extern uint32_t const bt_glyph_fragment_spirv_byte_size;
-extern uint32_t const bt_font_curves_byte_size;
-extern uint32_t const bt_font_curve_infos_byte_size;
-extern uint32_t const bt_font_metrics_byte_size;
+extern uint32_t const bt_glyph_dual_axis_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_fp16_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_fp16_aliased_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_linear_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_atlas_vertex_spirv_byte_size;
+extern uint32_t const bt_glyph_atlas_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_alpha_to_coverage_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_heatmap_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_dual_axis_heatmap_fragment_spirv_byte_size;
+extern uint32_t const bt_text2d_composite_vertex_spirv_byte_size;
+extern uint32_t const bt_text2d_composite_fragment_spirv_byte_size;
+extern uint32_t const bt_text2d_bin_compute_spirv_byte_size;
+extern uint32_t const bt_text2d_tiles_compute_spirv_byte_size;
+extern uint32_t const bt_glyph_texture_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_dual_axis_texture_fragment_spirv_byte_size;
+extern uint32_t const
+    bt_glyph_alpha_to_coverage_texture_fragment_spirv_byte_size;
+extern uint32_t const bt_glyph_atlas_texture_fragment_spirv_byte_size;
+extern uint32_t const bt_text2d_tiles_texture_compute_spirv_byte_size;
 
 extern uint32_t const bt_glyph2d_vertex_spirv_len;
 extern uint32_t const bt_glyph3d_vertex_spirv_len;
 extern uint32_t const bt_glyph_fragment_spirv_len;
-extern uint32_t const bt_font_curves_len;
-extern uint32_t const bt_font_curve_infos_len;
-extern uint32_t const bt_font_metrics_len;
+extern uint32_t const bt_glyph_dual_axis_fragment_spirv_len;
+extern uint32_t const bt_glyph_fp16_fragment_spirv_len;
+extern uint32_t const bt_glyph_fp16_aliased_fragment_spirv_len;
+extern uint32_t const bt_glyph_linear_fragment_spirv_len;
+extern uint32_t const bt_glyph_atlas_vertex_spirv_len;
+extern uint32_t const bt_glyph_atlas_fragment_spirv_len;
+extern uint32_t const bt_glyph_alpha_to_coverage_fragment_spirv_len;
+extern uint32_t const bt_glyph_heatmap_fragment_spirv_len;
+extern uint32_t const bt_glyph_dual_axis_heatmap_fragment_spirv_len;
+extern uint32_t const bt_text2d_composite_vertex_spirv_len;
+extern uint32_t const bt_text2d_composite_fragment_spirv_len;
+extern uint32_t const bt_text2d_bin_compute_spirv_len;
+extern uint32_t const bt_text2d_tiles_compute_spirv_len;
+extern uint32_t const bt_glyph_texture_fragment_spirv_len;
+extern uint32_t const bt_glyph_dual_axis_texture_fragment_spirv_len;
+extern uint32_t const bt_glyph_alpha_to_coverage_texture_fragment_spirv_len;
+extern uint32_t const bt_glyph_atlas_texture_fragment_spirv_len;
+extern uint32_t const bt_text2d_tiles_texture_compute_spirv_len;
 
 #endif
@@ -0,0 +1,342 @@
+#include "font.h"
+#include "logging.h"
+#include <SDL3/SDL_stdinc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct bt_font_reader {
+  char const *path;
+  unsigned char const *bytes;
+  size_t size;
+  size_t offset;
+};
+
+/*
+ * Validates the next section of the pack and returns a pointer to its
+ * elements, or nullptr if it is invalid.
+ */
+static void const *bt_font_read_section(struct bt_font_reader reader[static 1],
+                                        uint32_t magic, uint32_t element_size,
+                                        uint32_t len[static 1]) {
+  struct bt_font_data_header const *header =
+      (struct bt_font_data_header const *)(reader->bytes + reader->offset);
+  if (reader->size - reader->offset < sizeof(*header)) {
+    BT_LOG_ERR("%s is truncated", reader->path);
+    return nullptr;
+  }
+  if (header->magic != magic || header->version != bt_font_data_version ||
+      header->element_size != element_size) {
+    BT_LOG_ERR("%s has an invalid section at offset %zu", reader->path,
+               reader->offset);
+    return nullptr;
+  }
+
+  size_t payload_size = (size_t)header->count * element_size;
+  if (reader->size - reader->offset - sizeof(*header) < payload_size) {
+    BT_LOG_ERR("%s is truncated", reader->path);
+    return nullptr;
+  }
+
+  size_t aligned_size = sizeof(*header) + payload_size;
+  aligned_size += (bt_font_pack_section_alignment -
+                   aligned_size % bt_font_pack_section_alignment) %
+                  bt_font_pack_section_alignment;
+  reader->offset = SDL_min(reader->offset + aligned_size, reader->size);
+  *len = header->count;
+
+  return header + 1;
+}
+
+/*
+ * Checks that the components of the composite glyph are in the band section
+ * and refer to glyphs that aren't composite themselves
+ */
+static bool
+bt_font_valid_composite(struct bt_font const font[static 1],
+                        struct bt_font_curve_info const info[static 1]) {
+  if (info->band_start >= font->bands_len) {
+    return false;
+  }
+  uint32_t const *components = &font->bands[info->band_start];
+  if (components[0] > (font->bands_len - info->band_start - 1) / 2) {
+    return false;
+  }
+  for (uint32_t i = 0; i < components[0]; i += 1) {
+    uint32_t glyph = components[1 + 2 * i];
+    if (glyph >= font->curve_infos_len ||
+        font->curve_infos[glyph].band_count == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Checks that the band pairs and occupancy grid of the glyph with curves are
+ * in the band section, and that its band lists are too and only refer to its
+ * own curves. The curve range has to be checked already.
+ */
+static bool
+bt_font_valid_bands(struct bt_font const font[static 1],
+                    struct bt_font_curve_info const info[static 1]) {
+  // The horizontal and vertical pairs, then the grid
+  uint64_t words = 4 * (uint64_t)info->band_count + bt_font_grid_words;
+  if (info->band_start > font->bands_len ||
+      words > font->bands_len - info->band_start) {
+    return false;
+  }
+  uint32_t curve_count = info->end - info->start;
+  uint32_t const *pairs = &font->bands[info->band_start];
+  for (uint32_t i = 0; i < 2 * info->band_count; i += 1) {
+    uint32_t start = pairs[2 * i];
+    uint32_t end = pairs[2 * i + 1];
+    if (start > end || end > font->bands_len) {
+      return false;
+    }
+    for (uint32_t j = start; j < end; j += 1) {
+      if ((font->bands[j] & bt_font_band_index_mask) >= curve_count) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool bt_font_read_pack(struct bt_font font[static 1],
+                              char const *path) {
+  struct bt_font_reader reader = {
+      .path = path,
+      .bytes = font->mapping,
+      .size = font->mapping_size,
+  };
+
+  struct bt_font_pack_header const *header = font->mapping;
+  if (reader.size < sizeof(*header) ||
+      header->magic != bt_font_data_magic_pack) {
+    BT_LOG_ERR("%s is not a font pack", path);
+    return false;
+  }
+  if (header->version != bt_font_data_version ||
+      header->section_count != bt_font_pack_section_count) {
+    BT_LOG_ERR("%s has version %u, expected %u; rebuild it with fontc", path,
+               header->version, bt_font_data_version);
+    return false;
+  }
+  reader.offset = sizeof(*header);
+
+  font->curves = bt_font_read_section(&reader, bt_font_data_magic_curves,
+                                      sizeof(*font->curves),
+                                      &font->curves_len);
+  if (!font->curves) {
+    return false;
+  }
+  font->curve_infos = bt_font_read_section(&reader, bt_font_data_magic_infos,
+                                           sizeof(*font->curve_infos),
+                                           &font->curve_infos_len);
+  if (!font->curve_infos) {
+    return false;
+  }
+  font->metrics = bt_font_read_section(&reader, bt_font_data_magic_metrics,
+                                       sizeof(*font->metrics),
+                                       &font->metrics_len);
+  if (!font->metrics) {
+    return false;
+  }
+  font->bands = bt_font_read_section(&reader, bt_font_data_magic_bands,
+                                     sizeof(*font->bands), &font->bands_len);
+  if (!font->bands) {
+    return false;
+  }
+  font->cmap = bt_font_read_section(&reader, bt_font_data_magic_cmap,
+                                    sizeof(*font->cmap), &font->cmap_len);
+  if (!font->cmap) {
+    return false;
+  }
+
+  if (font->curve_infos_len / bt_font_lod_count != font->metrics_len ||
+      font->curve_infos_len % bt_font_lod_count != 0) {
+    BT_LOG_ERR("%s has %u curve infos but %u metrics", path,
+               font->curve_infos_len, font->metrics_len);
+    return false;
+  }
+  if (font->metrics_len > bt_font_max_glyphs) {
+    BT_LOG_ERR("%s has %u glyphs, more than %u", path, font->metrics_len,
+               bt_font_max_glyphs);
+    return false;
+  }
+  for (uint32_t i = 0; i < font->curve_infos_len; i += 1) {
+    struct bt_font_curve_info const *info = &font->curve_infos[i];
+    if (info->start > info->end || info->end > font->curves_len) {
+      BT_LOG_ERR("%s has invalid curves for glyph %u", path, i);
+      return false;
+    }
+    if (info->band_count == 0 && !bt_font_valid_composite(font, info)) {
+      BT_LOG_ERR("%s has an invalid composite glyph %u", path, i);
+      return false;
+    }
+    if (info->band_count > 0 && !bt_font_valid_bands(font, info)) {
+      BT_LOG_ERR("%s has invalid bands for glyph %u", path, i);
+      return false;
+    }
+  }
+  if (font->cmap_len == 0 || font->cmap_len - 1 < font->cmap[0]) {
+    BT_LOG_ERR("%s has a truncated cmap", path);
+    return false;
+  }
+  for (uint32_t i = 0; i < font->cmap[0]; i += 1) {
+    if (font->cmap_len < bt_font_cmap_page_size ||
+        font->cmap[1 + i] > font->cmap_len - bt_font_cmap_page_size) {
+      BT_LOG_ERR("%s has an invalid cmap page", path);
+      return false;
+    }
+  }
+  // The glyph indices, once the pages are known to be in the cmap
+  for (uint32_t i = 0; i < font->cmap[0]; i += 1) {
+    uint32_t const *page = &font->cmap[font->cmap[1 + i]];
+    for (uint32_t j = 0; j < bt_font_cmap_page_size; j += 1) {
+      if (page[j] >= font->metrics_len) {
+        BT_LOG_ERR("%s maps codepoint %u to glyph %u of %u", path,
+                   i << bt_font_cmap_page_bits | j, page[j],
+                   font->metrics_len);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool bt_font_load(struct bt_font font[static 1], char const *path) {
+  SDL_zerop(font);
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    BT_LOG_ERR("Failed to open font pack %s: %s", path, strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    BT_LOG_ERR("Failed to stat font pack %s: %s", path, strerror(errno));
+    close(fd);
+    return false;
+  }
+  if (st.st_size <= 0) {
+    BT_LOG_ERR("%s is not a font pack", path);
+    close(fd);
+    return false;
+  }
+
+  void *mapping =
+      mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    BT_LOG_ERR("Failed to map font pack %s: %s", path, strerror(errno));
+    return false;
+  }
+  font->mapping = mapping;
+  font->mapping_size = (size_t)st.st_size;
+
+  if (!bt_font_read_pack(font, path)) {
+    bt_font_unload(font);
+    return false;
+  }
+
+  return true;
+}
+
+void bt_font_unload(struct bt_font font[static 1]) {
+  if (font->mapping) {
+    munmap(font->mapping, font->mapping_size);
+  }
+  SDL_zerop(font);
+}
+
+uint32_t bt_font_glyph_index(struct bt_font const font[static 1],
+                             uint32_t codepoint) {
+  uint32_t page = codepoint >> bt_font_cmap_page_bits;
+  if (page >= font->cmap[0]) {
+    return 0;
+  }
+  return font->cmap[font->cmap[1 + page] +
+                    (codepoint & (bt_font_cmap_page_size - 1))];
+}
+
+bool bt_font_stack_load(struct bt_font_stack stack[static 1],
+                        uint32_t path_count, char const *const paths[]) {
+  SDL_zerop(stack);
+
+  if (path_count == 0 || path_count > bt_font_stack_max_fonts) {
+    BT_LOG_ERR("Expected 1 to %u font packs, got %u", bt_font_stack_max_fonts,
+               path_count);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < path_count; i += 1) {
+    if (!bt_font_load(&stack->fonts[i], paths[i])) {
+      bt_font_stack_unload(stack);
+      return false;
+    }
+    if (stack->fonts[i].curve_infos_len > bt_font_stack_glyph_mask + 1) {
+      BT_LOG_ERR("%s has too many glyphs", paths[i]);
+      bt_font_unload(&stack->fonts[i]);
+      bt_font_stack_unload(stack);
+      return false;
+    }
+    stack->font_count += 1;
+  }
+
+  return true;
+}
+
+void bt_font_stack_unload(struct bt_font_stack stack[static 1]) {
+  for (uint32_t i = 0; i < stack->font_count; i += 1) {
+    bt_font_unload(&stack->fonts[i]);
+  }
+  SDL_zerop(stack);
+}
+
+uint32_t bt_font_stack_glyph(struct bt_font_stack const stack[static 1],
+                             uint32_t codepoint) {
+  for (uint32_t i = 0; i < stack->font_count; i += 1) {
+    uint32_t glyph = bt_font_glyph_index(&stack->fonts[i], codepoint);
+    if (glyph != 0) {
+      return i << bt_font_stack_glyph_bits | glyph;
+    }
+  }
+  return 0;
+}
+
+uint32_t bt_font_stack_glyph_lod(struct bt_font_stack const stack[static 1],
+                                 uint32_t packed_glyph, uint32_t level) {
+  struct bt_font const *font =
+      &stack->fonts[packed_glyph >> bt_font_stack_glyph_bits];
+  return packed_glyph + level * font->metrics_len;
+}
+
+struct bt_font_metrics const *
+bt_font_stack_metrics(struct bt_font_stack const stack[static 1],
+                      uint32_t packed_glyph) {
+  struct bt_font const *font =
+      &stack->fonts[packed_glyph >> bt_font_stack_glyph_bits];
+  return &font->metrics[packed_glyph & bt_font_stack_glyph_mask];
+}
+
+void bt_font_stack_offsets(
+    struct bt_font_stack const stack[static 1],
+    struct bt_font_offsets out[static bt_font_stack_max_fonts + 1]) {
+  struct bt_font_offsets offsets = {};
+  for (uint32_t i = 0; i <= bt_font_stack_max_fonts; i += 1) {
+    out[i] = offsets;
+    if (i < stack->font_count) {
+      out[i].glyph_count = stack->fonts[i].metrics_len;
+      offsets.curve_info += stack->fonts[i].curve_infos_len;
+      offsets.band += stack->fonts[i].bands_len;
+      offsets.metrics += stack->fonts[i].metrics_len;
+    }
+  }
+}
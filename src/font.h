@@ -0,0 +1,105 @@
+#ifndef BT_FONT_H
+#define BT_FONT_H
+
+#include "data.h"
+#include <stddef.h>
+
+/*
+ * A font pack produced by tools/fontc.c, mapped into memory. The section
+ * pointers are views into the mapping, so the data lives in the page cache and
+ * is shared with any other process that has the same pack open.
+ */
+struct bt_font {
+  void *mapping;
+  size_t mapping_size;
+  struct bt_font_curve const *curves;
+  struct bt_font_curve_info const *curve_infos;
+  struct bt_font_metrics const *metrics;
+  uint32_t const *bands;
+  uint32_t const *cmap;
+  uint32_t curves_len;
+  uint32_t curve_infos_len;
+  uint32_t metrics_len;
+  uint32_t bands_len;
+  uint32_t cmap_len;
+};
+
+constexpr uint32_t bt_font_stack_max_fonts = 8;
+/*
+ * Glyph instances hold the index of a glyph within its font in 16 bits
+ */
+constexpr uint32_t bt_font_max_glyphs = 1u << 16;
+/*
+ * Glyphs resolved through a font stack are packed as
+ * font << bt_font_stack_glyph_bits | glyph index within the font
+ */
+constexpr uint32_t bt_font_stack_glyph_bits = 24;
+constexpr uint32_t bt_font_stack_glyph_mask =
+    (1u << bt_font_stack_glyph_bits) - 1;
+
+/*
+ * Fonts in fallback order. Their sections are concatenated into shared GPU
+ * buffers, so glyphs from any of them can be drawn in the same draw call.
+ */
+struct bt_font_stack {
+  struct bt_font fonts[bt_font_stack_max_fonts];
+  uint32_t font_count;
+};
+
+/*
+ * Where the curve info, band and metrics sections of a font start in the
+ * shared GPU buffers, in elements. The indices inside a font pack are relative
+ * to its own sections, so the shaders add these to them. Curves are placed by
+ * the glyph cache instead, see glyph_cache.h. `glyph_count` is how far apart
+ * the levels of detail of a glyph are in the curve infos, see
+ * bt_font_lod_count.
+ */
+struct bt_font_offsets {
+  alignas(16) uint32_t curve_info;
+  uint32_t band;
+  uint32_t glyph_count;
+  uint32_t metrics;
+};
+
+/*
+ * Maps the font pack at `path` and validates it. Logs and returns false on
+ * failure, in which case `font` doesn't need to be unloaded.
+ */
+bool bt_font_load(struct bt_font font[static 1], char const *path);
+void bt_font_unload(struct bt_font font[static 1]);
+/*
+ * Returns the glyph index of the codepoint, or 0 if the font doesn't have it
+ */
+uint32_t bt_font_glyph_index(struct bt_font const font[static 1],
+                             uint32_t codepoint);
+
+/*
+ * Loads the font packs in fallback order. Logs and returns false on failure,
+ * in which case `stack` doesn't need to be unloaded.
+ */
+bool bt_font_stack_load(struct bt_font_stack stack[static 1],
+                        uint32_t path_count, char const *const paths[]);
+void bt_font_stack_unload(struct bt_font_stack stack[static 1]);
+/*
+ * Returns the packed glyph of the first font in the stack that has the
+ * codepoint, or 0 (the empty glyph of the first font) if none of them do
+ */
+uint32_t bt_font_stack_glyph(struct bt_font_stack const stack[static 1],
+                             uint32_t codepoint);
+/*
+ * Returns the packed glyph of level of detail `level` of the packed glyph
+ */
+uint32_t bt_font_stack_glyph_lod(struct bt_font_stack const stack[static 1],
+                                 uint32_t packed_glyph, uint32_t level);
+struct bt_font_metrics const *
+bt_font_stack_metrics(struct bt_font_stack const stack[static 1],
+                      uint32_t packed_glyph);
+/*
+ * out[i] is where font i starts, and out[bt_font_stack_max_fonts] is the total
+ * size of the shared buffers
+ */
+void bt_font_stack_offsets(
+    struct bt_font_stack const stack[static 1],
+    struct bt_font_offsets out[static bt_font_stack_max_fonts + 1]);
+
+#endif
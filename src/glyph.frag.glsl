@@ -1,98 +1,135 @@
 #version 460 core
 
-struct bt_font_curve {
-    vec2 p0;
-    vec2 p1;
-    vec2 p2;
-};
-
-struct bt_font_curve_info {
-    uint start;
-    uint end;
-};
-
-layout(std140, set = 2, binding = 0) readonly buffer bt_font_curves {
-    bt_font_curve curves[];
-};
-
-layout(std140, set = 2, binding = 1) readonly buffer bt_font_curve_infos {
-    bt_font_curve_info curve_infos[];
-};
+// Built as is and once per variant in the Makefile, with some of these defined:
+// BT_DUAL_AXIS: also casts a vertical ray, see analytic_coverage
+// BT_FP16: solves for the crossings in half precision
+// BT_ALIASED: no antialiasing, pixels are either covered or not
+// BT_LINEAR_WALK: walks every curve of the glyph instead of one band
+// BT_ATLAS: rasterizes glyphs into the glyph atlas instead of drawing them
+// BT_ALPHA_TO_COVERAGE: never discards, for multisampled pipelines that turn
+// the alpha into a sample mask
+// BT_HEATMAP: draws how many curves each pixel tested instead of the text
+// BT_CURVE_TEXTURE: reads the curves and curve infos from textures instead of
+// storage buffers, see bt_curve_storage in state.h
+
+#extension GL_GOOGLE_include_directive : require
+
+#ifdef BT_ATLAS
+// Renders into the atlas, so it can't sample it
+#define BT_FONT_BINDING 0
+#else
+// Small glyphs rasterized by the BT_ATLAS variant, see glyph_atlas.h
+layout(set = 2, binding = 0) uniform sampler2D atlas;
+#define BT_FONT_BINDING 1
+#endif
+#define BT_FONT_SET 2
+#include "glyph_coverage.glsli"
 
 layout(location = 0) in vec2 in_uv;
 layout(location = 1) in vec3 in_color;
-layout(location = 2) flat in uint in_char;
+layout(location = 2) flat in uint in_glyph;
+#ifndef BT_ATLAS
+layout(location = 3) flat in uint in_atlas;
+layout(location = 4) flat in uint in_lod;
+// bt_glyph_effects in state.h
+layout(location = 5) flat in float in_outline_width;
+layout(location = 6) flat in vec2 in_shadow_offset;
+layout(location = 7) flat in vec4 in_outline_color;
+layout(location = 8) flat in vec4 in_shadow_color;
+#endif
 layout(location = 0) out vec4 out_color;
-
-float compute_coverage(float inverse_diameter, vec2 p0, vec2 p1, vec2 p2) {
-    vec2 a = p0 - 2.0 * p1 + p2;
-    vec2 b = p0 - p1;
-    vec2 c = p0;
-
-    float t0;
-    float t1;
-
-    if (abs(a.y) >= 1e-5) {
-        float radicand = b.y * b.y - a.y * c.y;
-        if (radicand <= 0)
-            return 0.0;
-
-        float s = sqrt(radicand);
-        t0 = (b.y - s) / a.y;
-        t1 = (b.y + s) / a.y;
-    } else {
-        float t = p0.y / (p0.y - p2.y);
-        if (p0.y < p2.y) {
-            t0 = -1.0;
-            t1 = t;
-        } else {
-            t0 = t;
-            t1 = -1.0;
-        }
-    }
-
-    float alpha = 0.0;
-
-    if (t0 >= 0.0 && t0 < 1.0) {
-        float x = (a.x * t0 - 2.0 * b.x) * t0 + c.x;
-        alpha += clamp(x * inverse_diameter + 0.5, 0, 1);
+#ifdef BT_HEATMAP
+// Added up over the frame by the pipeline's blending, see the heatmap glyph
+// quality in state.h
+layout(location = 1) out vec2 out_curves;
+#endif
+
+#ifndef BT_ATLAS
+// Cells of the glyph atlas, see glyph_atlas.h
+const float bt_glyph_atlas_texels = 2048.0;
+const uint bt_glyph_atlas_cell_texels = 64;
+const uint bt_glyph_atlas_cells_per_row = 32;
+const float bt_glyph_atlas_sizes[] = float[](8.0, 12.0, 16.0, 24.0, 32.0, 44.0, 62.0);
+const uint bt_glyph_atlas_size_shift = 16;
+const uint bt_glyph_atlas_cell_mask = (1u << bt_glyph_atlas_size_shift) - 1u;
+const uint bt_glyph_atlas_none = 0xFFFFFFFFu;
+// How far the texels of a cell may be from one per pixel before the glyph is
+// drawn from its curves instead, for glyphs that got closer or further away
+// since their cell was picked
+const float bt_glyph_atlas_max_magnification = 1.5;
+const float bt_glyph_atlas_max_minification = 2.0;
+
+#ifdef BT_HEATMAP
+// Curves tested by a pixel that get the hottest color
+const float bt_heatmap_max_curves = 32.0;
+
+// Blue through cyan, green and yellow to red
+vec3 heat_color(float curves) {
+    float t = clamp(curves / bt_heatmap_max_curves, 0.0, 1.0);
+    return clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+}
+#endif
+
+// Coverage from the glyph's atlas cell, if it has one and is drawn at about
+// the size it was rasterized at. Returns false otherwise.
+bool atlas_coverage(vec2 uv, vec2 uv_per_pixel, out float alpha) {
+    alpha = 0.0;
+    if (in_atlas == bt_glyph_atlas_none) {
+        return false;
     }
-
-    if (t1 >= 0.0 && t1 < 1.0) {
-        float x = (a.x * t1 - 2.0 * b.x) * t1 + c.x;
-        alpha -= clamp(x * inverse_diameter + 0.5, 0, 1);
+    float size = bt_glyph_atlas_sizes[in_atlas >> bt_glyph_atlas_size_shift];
+    float texels_per_pixel = max(uv_per_pixel.x, uv_per_pixel.y) * size;
+    if (texels_per_pixel < 1.0 / bt_glyph_atlas_max_magnification || texels_per_pixel > bt_glyph_atlas_max_minification) {
+        return false;
     }
 
-    return alpha;
+    uint cell = in_atlas & bt_glyph_atlas_cell_mask;
+    vec2 cell_min = vec2(cell % bt_glyph_atlas_cells_per_row, cell / bt_glyph_atlas_cells_per_row) * float(bt_glyph_atlas_cell_texels);
+    // The glyph quad starts after a texel of padding, and the margin around
+    // the glyph bounds may reach past the quad but not past the cell
+    vec2 texel = clamp(cell_min + 1.0 + uv * size, cell_min + 0.5, cell_min + float(bt_glyph_atlas_cell_texels) - 0.5);
+    // Explicit level, the branch isn't uniform
+    alpha = textureLod(atlas, texel / bt_glyph_atlas_texels, 0.0).r;
+    return true;
 }
+#endif
 
 void main() {
     vec2 uv = in_uv;
+    vec2 uv_per_pixel = fwidth(uv);
+#ifdef BT_ATLAS
+    // Writes every texel of the cell, the empty ones included
+    out_color = vec4(clamp(analytic_coverage(uv, uv_per_pixel, in_glyph, 0), 0.0, 1.0));
+#else
+    float alpha;
     vec3 color = in_color;
-    uint char = in_char;
-
-    float alpha = 0.0;
-    float inverse_diameter = 1.0 / fwidth(uv).x;
-    bt_font_curve_info info = curve_infos[char];
-    for (uint i = info.start; i < info.end; i += 1) {
-        bt_font_curve curve = curves[i];
-        vec2 uv = uv;
-        vec2 p0 = curve.p0 - uv;
-        vec2 p1 = curve.p1 - uv;
-        vec2 p2 = curve.p2 - uv;
-        float min_y = min(min(p0.y, p1.y), p2.y);
-        float max_y = max(max(p0.y, p1.y), p2.y);
-        if (min_y > 0.0 || max_y < 0.0) {
-            continue;
+    if ((in_outline_width > 0.0 && in_outline_color.a > 0.0) || in_shadow_color.a > 0.0) {
+        // The atlas only has the fill, the effects need the curves
+        vec4 effects = effects_coverage(uv, uv_per_pixel, in_glyph, in_lod, in_color, in_outline_width, in_outline_color, in_shadow_offset, in_shadow_color);
+        alpha = effects.a;
+        if (alpha > 0.0) {
+            color = effects.rgb / alpha;
         }
-        alpha += compute_coverage(inverse_diameter, p0, p1, p2);
+    } else if (!atlas_coverage(uv, uv_per_pixel, alpha)) {
+        alpha = analytic_coverage(uv, uv_per_pixel, in_glyph, in_lod);
     }
 
+#ifdef BT_HEATMAP
+    // Every pixel of the quad is shaded, the ones that end up empty included
+    out_color = vec4(heat_color(float(heatmap_curves_tested)), 1.0);
+    out_curves = vec2(heatmap_curves_tested, heatmap_curves_accepted);
+#else
+#ifndef BT_ALPHA_TO_COVERAGE
     // Discard so that the transparent pixels of the quad don't overlap with
-    // other quads and cause depth issues
+    // other quads and cause depth issues. Alpha to coverage leaves the samples
+    // of those pixels alone instead, and without a discard the depth test can
+    // run before the shader.
     if (alpha <= 0.0) {
         discard;
     }
+#endif
 
     out_color = vec4(color, min(alpha, 1.0));
+#endif
+#endif
 }
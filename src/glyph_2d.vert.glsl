@@ -1,47 +1,91 @@
 #version 460
+#extension GL_GOOGLE_include_directive : require
 
 layout(std140, set = 1, binding = 0) uniform readonly uniforms {
     mat4x4 u_proj_view;
     float u_aspect_ratio;
 };
 
+#define BT_RUN_SET 0
+#define BT_RUN_BINDING 0
+#define BT_FONT_OFFSETS_BINDING 2
+#include "glyph_run.glsli"
+
 layout(location = 0) in vec3 in_color;
-layout(location = 1) in vec2 in_scale;
-layout(location = 2) in float in_rotation;
-layout(location = 3) in vec2 in_translation;
-layout(location = 4) in uint in_char;
+layout(location = 1) in uvec2 in_glyph;
+// The run and the advance, see bt_glyph_instance_data in state.h
+layout(location = 2) in uint in_run_advance;
 
 layout(location = 0) out vec2 out_uv;
 layout(location = 1) out vec3 out_color;
-layout(location = 2) flat out uint out_char;
+layout(location = 2) flat out uint out_glyph;
+layout(location = 3) flat out uint out_atlas;
+layout(location = 4) flat out uint out_lod;
+layout(location = 5) flat out float out_outline_width;
+layout(location = 6) flat out vec2 out_shadow_offset;
+layout(location = 7) flat out vec4 out_outline_color;
+layout(location = 8) flat out vec4 out_shadow_color;
+
+// Grid of the glyph bounds, see data.h
+const float bt_font_curve_min = -0.5;
+const float bt_font_curve_step = 2.0 / 65536.0;
+// Room around the glyph bounds for the anti-aliased edge, in glyph quad units
+const float bt_glyph_bounds_margin = 1.0 / 32.0;
+// See bt_glyph_instance_size_shift in state.h, bt_font_stack_glyph_bits in
+// font.h and bt_glyph_atlas_size_shift in glyph_atlas.h
+const uint bt_glyph_instance_size_shift = 10;
+const uint bt_glyph_instance_atlas_none = (1u << bt_glyph_instance_font_shift) - 1u;
+const uint bt_font_stack_glyph_bits = 24;
+const uint bt_glyph_atlas_size_shift = 16;
+const uint bt_glyph_atlas_none = 0xFFFFFFFFu;
+
+// The packed glyph and atlas cell the fragment shader takes, from the two 16
+// bit words of the instance
+void unpack_glyph(uvec2 ids, out uint glyph, out uint atlas) {
+    glyph = (ids.y >> bt_glyph_instance_font_shift) << bt_font_stack_glyph_bits | ids.x;
+    uint cell = ids.y & bt_glyph_instance_atlas_none;
+    atlas = cell == bt_glyph_instance_atlas_none ? bt_glyph_atlas_none : (cell >> bt_glyph_instance_size_shift) << bt_glyph_atlas_size_shift | (cell & ((1u << bt_glyph_instance_size_shift) - 1u));
+}
 
 void main() {
-    vec2 pos;
-    vec2 uv;
-    vec2 scale = in_scale;
-    float rotation = in_rotation;
-    vec2 translation = in_translation;
-    switch (gl_VertexIndex) {
-        case 0:
-        pos = vec2(-0.5f, 0.5f);
-        uv = vec2(0.0f, 0.0f);
-        break;
-        case 1:
-        pos = vec2(0.5f, 0.5f);
-        uv = vec2(1.0f, 0.0f);
-        break;
-        case 2:
-        pos = vec2(-0.5f, -0.5f);
-        uv = vec2(0.0f, 1.0f);
-        break;
-        case 3:
-        pos = vec2(0.5f, -0.5f);
-        uv = vec2(1.0f, 1.0f);
-        break;
+    bt_text_run run = glyph_run(in_run_advance);
+    vec2 scale = vec2(run.scale);
+    float rotation = run.rotation[0];
+    // The run leaves out the x half of the first quad, see bt_text_run_data in
+    // state.h
+    vec2 translation = vec2(run.translation[0] + 0.5 * run.scale / u_aspect_ratio, run.translation[1]);
+    vec4 effects = run_effects(run);
+    float outline_width = effects.x;
+    vec2 shadow_offset = effects.yz;
+    vec4 outline_color = unpackUnorm4x8(run.outline_color);
+    vec4 shadow_color = unpackUnorm4x8(run.shadow_color);
+    // The quad covers the glyph bounds instead of the whole glyph quad, so
+    // the fragment shader doesn't run for the empty space around the glyph
+    vec2 corner = vec2(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1);
+    vec4 bounds = vec4(glyph_bounds(in_glyph)) * bt_font_curve_step + bt_font_curve_min;
+    vec2 bounds_min = bounds.xy;
+    vec2 bounds_max = bounds.zw;
+    if (any(greaterThan(bounds_min, bounds_max))) {
+        // No curves, collapse the quad
+        bounds_max = bounds_min;
+    } else {
+        // The outline and the shadow reach past the glyph bounds
+        vec2 shadow = shadow_color.a > 0.0 ? shadow_offset : vec2(0.0);
+        bounds_min += min(shadow, 0.0) - outline_width - bt_glyph_bounds_margin;
+        bounds_max += max(shadow, 0.0) + outline_width + bt_glyph_bounds_margin;
     }
+    vec2 uv = mix(bounds_min, bounds_max, corner);
+    // Along the run, which rotates and scales with the glyphs
+    vec2 pos = vec2(uv.x - 0.5 + glyph_advance(in_run_advance), 0.5 - uv.y);
     out_uv = uv;
     out_color = in_color;
-    out_char = in_char;
+    unpack_glyph(in_glyph, out_glyph, out_atlas);
+    out_outline_width = outline_width;
+    out_shadow_offset = shadow_offset;
+    out_outline_color = outline_color;
+    out_shadow_color = shadow_color;
+    // The 2D text always uses the full outlines
+    out_lod = 0;
 
     float sin_rot = sin(rotation);
     float cos_rot = cos(rotation);
@@ -1,19 +1,49 @@
 #version 460
+#extension GL_GOOGLE_include_directive : require
 
 layout(std140, set = 1, binding = 0) uniform readonly uniforms {
     mat4x4 u_proj_view;
     float u_aspect_ratio;
+    float u_viewport_height;
 };
 
+#define BT_RUN_SET 0
+#define BT_RUN_BINDING 0
+#define BT_FONT_OFFSETS_BINDING 2
+#include "glyph_run.glsli"
+
 layout(location = 0) in vec3 in_color;
-layout(location = 1) in vec3 in_scale;
-layout(location = 2) in vec4 in_rotation;
-layout(location = 3) in vec3 in_translation;
-layout(location = 4) in uint in_char;
+layout(location = 1) in uvec2 in_glyph;
+// The run and the advance, see bt_glyph_instance_data in state.h
+layout(location = 2) in uint in_run_advance;
 
 layout(location = 0) out vec2 out_uv;
 layout(location = 1) out vec3 out_color;
-layout(location = 2) flat out uint out_char;
+layout(location = 2) flat out uint out_glyph;
+layout(location = 3) flat out uint out_atlas;
+layout(location = 4) flat out uint out_lod;
+layout(location = 5) flat out float out_outline_width;
+layout(location = 6) flat out vec2 out_shadow_offset;
+layout(location = 7) flat out vec4 out_outline_color;
+layout(location = 8) flat out vec4 out_shadow_color;
+
+// Grid of the glyph bounds, see data.h
+const float bt_font_curve_min = -0.5;
+const float bt_font_curve_step = 2.0 / 65536.0;
+// Room around the glyph bounds for the anti-aliased edge, in glyph quad units
+const float bt_glyph_bounds_margin = 1.0 / 32.0;
+// Glyph quads that span fewer pixels than these on screen use the simplified
+// outlines of levels of detail 1 and 2, see bt_font_lod_count in data.h. The
+// font compiler keeps those within a quarter of a pixel of the full outline
+// at these sizes.
+const float bt_glyph_lod_pixels[] = float[](64.0, 16.0);
+// See bt_glyph_instance_size_shift in state.h, bt_font_stack_glyph_bits in
+// font.h and bt_glyph_atlas_size_shift in glyph_atlas.h
+const uint bt_glyph_instance_size_shift = 10;
+const uint bt_glyph_instance_atlas_none = (1u << bt_glyph_instance_font_shift) - 1u;
+const uint bt_font_stack_glyph_bits = 24;
+const uint bt_glyph_atlas_size_shift = 16;
+const uint bt_glyph_atlas_none = 0xFFFFFFFFu;
 
 mat3 quat_to_mat3(vec4 quat) {
     float x = quat.x;
@@ -38,34 +68,80 @@ mat3 quat_to_mat3(vec4 quat) {
     return mat3(vec3(1.0 - (yy + zz), xy + wz, xz - wy), vec3(xy - wz, 1.0 - (xx + zz), yz + wx), vec3(xz + wy, yz - wx, 1.0 - (xx + yy)));
 }
 
+// The packed glyph and atlas cell the fragment shader takes, from the two 16
+// bit words of the instance
+void unpack_glyph(uvec2 ids, out uint glyph, out uint atlas) {
+    glyph = (ids.y >> bt_glyph_instance_font_shift) << bt_font_stack_glyph_bits | ids.x;
+    uint cell = ids.y & bt_glyph_instance_atlas_none;
+    atlas = cell == bt_glyph_instance_atlas_none ? bt_glyph_atlas_none : (cell >> bt_glyph_instance_size_shift) << bt_glyph_atlas_size_shift | (cell & ((1u << bt_glyph_instance_size_shift) - 1u));
+}
+
+// Pixels the glyph quad drawn with `model_view_proj` spans on screen along its
+// longer side
+float projected_size(mat4 model_view_proj) {
+    vec4 center = model_view_proj * vec4(0.0, 0.0, 0.0, 1.0);
+    vec4 right = model_view_proj * vec4(0.5, 0.0, 0.0, 1.0);
+    vec4 up = model_view_proj * vec4(0.0, 0.5, 0.0, 1.0);
+    if (min(center.w, min(right.w, up.w)) <= 0.0) {
+        // Partly behind the camera, so as close as it gets
+        return 1.0e30;
+    }
+    // Half the quad each way, and normalized device coordinates span the
+    // window twice, so these are the whole quad in pixels
+    vec2 window = vec2(u_viewport_height * u_aspect_ratio, u_viewport_height);
+    vec2 width = (right.xy / right.w - center.xy / center.w) * window;
+    vec2 height = (up.xy / up.w - center.xy / center.w) * window;
+    return max(length(width), length(height));
+}
+
 void main() {
-    vec2 pos;
-    vec2 uv;
-    vec3 scale = in_scale;
-    vec4 rotation = in_rotation;
-    vec3 translation = in_translation;
-    switch (gl_VertexIndex % 4) {
-        case 0:
-        pos = vec2(-0.5f, 0.5f);
-        uv = vec2(0.0f, 0.0f);
-        break;
-        case 1:
-        pos = vec2(0.5f, 0.5f);
-        uv = vec2(1.0f, 0.0f);
-        break;
-        case 2:
-        pos = vec2(-0.5f, -0.5f);
-        uv = vec2(0.0f, 1.0f);
-        break;
-        case 3:
-        pos = vec2(0.5f, -0.5f);
-        uv = vec2(1.0f, 1.0f);
-        break;
+    bt_text_run run = glyph_run(in_run_advance);
+    // The z scale doesn't matter for the flat quad
+    vec3 scale = vec3(run.scale);
+    vec4 rotation = vec4(run.rotation[0], run.rotation[1], run.rotation[2], run.rotation[3]);
+    vec4 effects = run_effects(run);
+    float outline_width = effects.x;
+    vec2 shadow_offset = effects.yz;
+    vec4 outline_color = unpackUnorm4x8(run.outline_color);
+    vec4 shadow_color = unpackUnorm4x8(run.shadow_color);
+    // The quad covers the glyph bounds instead of the whole glyph quad, so
+    // the fragment shader doesn't run for the empty space around the glyph
+    vec2 corner = vec2(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1);
+    vec4 bounds = vec4(glyph_bounds(in_glyph)) * bt_font_curve_step + bt_font_curve_min;
+    vec2 bounds_min = bounds.xy;
+    vec2 bounds_max = bounds.zw;
+    if (any(greaterThan(bounds_min, bounds_max))) {
+        // No curves, collapse the quad
+        bounds_max = bounds_min;
+    } else {
+        // The outline and the shadow reach past the glyph bounds
+        vec2 shadow = shadow_color.a > 0.0 ? shadow_offset : vec2(0.0);
+        bounds_min += min(shadow, 0.0) - outline_width - bt_glyph_bounds_margin;
+        bounds_max += max(shadow, 0.0) + outline_width + bt_glyph_bounds_margin;
     }
+    vec2 uv = mix(bounds_min, bounds_max, corner);
+    vec2 pos = vec2(uv.x - 0.5, 0.5 - uv.y);
     out_uv = uv;
     out_color = in_color;
-    out_char = in_char;
+    unpack_glyph(in_glyph, out_glyph, out_atlas);
+    out_outline_width = outline_width;
+    out_shadow_offset = shadow_offset;
+    out_outline_color = outline_color;
+    out_shadow_color = shadow_color;
     mat3 rot_mat = quat_to_mat3(rotation);
+    // Centered on the glyph rather than the start of the run, so that the
+    // level of detail below is picked for the glyph
+    vec3 translation = vec3(run.translation[0], run.translation[1], run.translation[2]) + rot_mat[0] * (scale.x * glyph_advance(in_run_advance));
     mat4 model = mat4(vec4(rot_mat[0] * scale.x, 0.0), vec4(rot_mat[1] * scale.y, 0.0), vec4(rot_mat[2] * scale.z, 0.0), vec4(translation, 1.0));
-    gl_Position = u_proj_view * model * vec4(pos, 0.0, 1.0);
+    mat4 model_view_proj = u_proj_view * model;
+    gl_Position = model_view_proj * vec4(pos, 0.0, 1.0);
+
+    // Every vertex of the quad picks the same level. All of them are in the
+    // glyph cache, see bt_text_touch_3d in state_text.c.
+    float size = projected_size(model_view_proj);
+    uint lod = 0;
+    while (lod < bt_glyph_lod_pixels.length() && size < bt_glyph_lod_pixels[lod]) {
+        lod += 1;
+    }
+    out_lod = lod;
 }
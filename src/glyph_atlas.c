@@ -0,0 +1,167 @@
+#include "glyph_atlas.h"
+#include "data.h"
+#include <SDL3/SDL_stdinc.h>
+
+static uint32_t bt_glyph_atlas_bucket(uint32_t packed_glyph, uint32_t size) {
+  return ((packed_glyph * bt_glyph_atlas_size_count + size) * 2654435761u) %
+         bt_glyph_atlas_bucket_count;
+}
+
+void bt_glyph_atlas_init(struct bt_glyph_atlas atlas[static 1]) {
+  SDL_zerop(atlas);
+
+  for (uint32_t i = 0; i < bt_glyph_atlas_cell_count; i += 1) {
+    atlas->cells[i] = (struct bt_glyph_atlas_cell){
+        .glyph = bt_glyph_atlas_none,
+        .prev = bt_glyph_atlas_none,
+        .next = bt_glyph_atlas_none,
+        .hash_next = bt_glyph_atlas_none,
+    };
+  }
+  for (uint32_t i = 0; i < bt_glyph_atlas_bucket_count; i += 1) {
+    atlas->buckets[i] = bt_glyph_atlas_none;
+  }
+  atlas->lru_head = bt_glyph_atlas_none;
+  atlas->lru_tail = bt_glyph_atlas_none;
+}
+
+uint32_t bt_glyph_atlas_size(float pixels) {
+  for (uint32_t i = 0; i < bt_glyph_atlas_size_count; i += 1) {
+    if (pixels <= (float)bt_glyph_atlas_sizes[i]) {
+      return i;
+    }
+  }
+  return bt_glyph_atlas_none;
+}
+
+bool bt_glyph_atlas_fits(uint16_t const bounds[static 4]) {
+  // Glyph quad coordinates 0 and 1 on the grid of the bounds
+  constexpr uint16_t min = (uint16_t)(-bt_font_curve_min / bt_font_curve_step);
+  constexpr uint16_t max =
+      (uint16_t)((1.0f - bt_font_curve_min) / bt_font_curve_step);
+  return bounds[0] <= bounds[2] && bounds[1] <= bounds[3] &&
+         bounds[0] >= min && bounds[1] >= min && bounds[2] <= max &&
+         bounds[3] <= max;
+}
+
+void bt_glyph_atlas_begin(struct bt_glyph_atlas atlas[static 1]) {
+  atlas->generation += 1;
+}
+
+static void bt_glyph_atlas_unlink(struct bt_glyph_atlas atlas[static 1],
+                                  uint32_t i) {
+  struct bt_glyph_atlas_cell *cell = &atlas->cells[i];
+  if (cell->prev != bt_glyph_atlas_none) {
+    atlas->cells[cell->prev].next = cell->next;
+  } else {
+    atlas->lru_head = cell->next;
+  }
+  if (cell->next != bt_glyph_atlas_none) {
+    atlas->cells[cell->next].prev = cell->prev;
+  } else {
+    atlas->lru_tail = cell->prev;
+  }
+  cell->prev = bt_glyph_atlas_none;
+  cell->next = bt_glyph_atlas_none;
+}
+
+static void bt_glyph_atlas_push_front(struct bt_glyph_atlas atlas[static 1],
+                                      uint32_t i) {
+  struct bt_glyph_atlas_cell *cell = &atlas->cells[i];
+  cell->next = atlas->lru_head;
+  if (atlas->lru_head != bt_glyph_atlas_none) {
+    atlas->cells[atlas->lru_head].prev = i;
+  } else {
+    atlas->lru_tail = i;
+  }
+  atlas->lru_head = i;
+}
+
+/*
+ * Frees the least recently used cell unless it belongs to the current set.
+ * Returns the cell, or bt_glyph_atlas_none if nothing could be evicted.
+ */
+static uint32_t bt_glyph_atlas_evict(struct bt_glyph_atlas atlas[static 1]) {
+  uint32_t i = atlas->lru_tail;
+  if (i == bt_glyph_atlas_none ||
+      atlas->cells[i].generation == atlas->generation) {
+    return bt_glyph_atlas_none;
+  }
+
+  struct bt_glyph_atlas_cell *cell = &atlas->cells[i];
+  bt_glyph_atlas_unlink(atlas, i);
+  uint32_t *link = &atlas->buckets[bt_glyph_atlas_bucket(cell->glyph,
+                                                         cell->size)];
+  while (*link != i) {
+    link = &atlas->cells[*link].hash_next;
+  }
+  *link = cell->hash_next;
+  cell->hash_next = bt_glyph_atlas_none;
+  cell->glyph = bt_glyph_atlas_none;
+  // Only if it was touched in an earlier set that hasn't been rasterized yet
+  for (uint32_t j = 0; j < atlas->pending_len; j += 1) {
+    if (atlas->pending[j] == i) {
+      atlas->pending_len -= 1;
+      atlas->pending[j] = atlas->pending[atlas->pending_len];
+      break;
+    }
+  }
+
+  return i;
+}
+
+uint32_t bt_glyph_atlas_touch(struct bt_glyph_atlas atlas[static 1],
+                              uint32_t packed_glyph, uint32_t size) {
+  uint32_t bucket = bt_glyph_atlas_bucket(packed_glyph, size);
+  for (uint32_t i = atlas->buckets[bucket]; i != bt_glyph_atlas_none;
+       i = atlas->cells[i].hash_next) {
+    struct bt_glyph_atlas_cell *cell = &atlas->cells[i];
+    if (cell->glyph == packed_glyph && cell->size == size) {
+      cell->generation = atlas->generation;
+      bt_glyph_atlas_unlink(atlas, i);
+      bt_glyph_atlas_push_front(atlas, i);
+      return size << bt_glyph_atlas_size_shift | i;
+    }
+  }
+
+  uint32_t i = atlas->used_count;
+  if (i < bt_glyph_atlas_cell_count) {
+    atlas->used_count += 1;
+  } else {
+    i = bt_glyph_atlas_evict(atlas);
+    if (i == bt_glyph_atlas_none) {
+      return bt_glyph_atlas_none;
+    }
+  }
+
+  atlas->cells[i] = (struct bt_glyph_atlas_cell){
+      .glyph = packed_glyph,
+      .size = size,
+      .generation = atlas->generation,
+      .prev = bt_glyph_atlas_none,
+      .next = bt_glyph_atlas_none,
+      .hash_next = atlas->buckets[bucket],
+  };
+  atlas->buckets[bucket] = i;
+  bt_glyph_atlas_push_front(atlas, i);
+  atlas->pending[atlas->pending_len] = i;
+  atlas->pending_len += 1;
+
+  return size << bt_glyph_atlas_size_shift | i;
+}
+
+void bt_glyph_atlas_stage(
+    struct bt_glyph_atlas const atlas[static 1],
+    struct bt_glyph_atlas_instance_data out[static bt_glyph_atlas_cell_count]) {
+  for (uint32_t j = 0; j < atlas->pending_len; j += 1) {
+    uint32_t i = atlas->pending[j];
+    out[j] = (struct bt_glyph_atlas_instance_data){
+        .atlas = atlas->cells[i].size << bt_glyph_atlas_size_shift | i,
+        .glyph = atlas->cells[i].glyph,
+    };
+  }
+}
+
+void bt_glyph_atlas_clear_pending(struct bt_glyph_atlas atlas[static 1]) {
+  atlas->pending_len = 0;
+}
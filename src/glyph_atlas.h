@@ -0,0 +1,109 @@
+#ifndef BT_GLYPH_ATLAS_H
+#define BT_GLYPH_ATLAS_H
+
+#include <stdint.h>
+
+/*
+ * The atlas texture is split into square cells, each holding one glyph
+ * rasterized at one size. The glyph quad starts after a texel of padding, so
+ * bilinear sampling never reads a neighbouring cell.
+ */
+constexpr uint32_t bt_glyph_atlas_texels = 2048;
+constexpr uint32_t bt_glyph_atlas_cell_texels = 64;
+constexpr uint32_t bt_glyph_atlas_cells_per_row =
+    bt_glyph_atlas_texels / bt_glyph_atlas_cell_texels;
+constexpr uint32_t bt_glyph_atlas_cell_count =
+    bt_glyph_atlas_cells_per_row * bt_glyph_atlas_cells_per_row;
+constexpr uint32_t bt_glyph_atlas_bucket_count = 2 * bt_glyph_atlas_cell_count;
+constexpr uint32_t bt_glyph_atlas_none = UINT32_MAX;
+
+/*
+ * Widths in texels the glyph quads are rasterized at. The on screen size of a
+ * glyph is rounded up to the next one, so a glyph drawn at slightly different
+ * sizes shares its cell. Larger glyphs are drawn from their curves.
+ */
+constexpr uint32_t bt_glyph_atlas_sizes[] = {8, 12, 16, 24, 32, 44, 62};
+constexpr uint32_t bt_glyph_atlas_size_count =
+    sizeof(bt_glyph_atlas_sizes) / sizeof(*bt_glyph_atlas_sizes);
+
+/*
+ * Cells are referred to as size << bt_glyph_atlas_size_shift | cell, with the
+ * size as an index into bt_glyph_atlas_sizes
+ */
+constexpr uint32_t bt_glyph_atlas_size_shift = 16;
+constexpr uint32_t bt_glyph_atlas_cell_mask =
+    (1u << bt_glyph_atlas_size_shift) - 1;
+
+/*
+ * Per instance data of the pass that rasterizes the pending cells
+ */
+struct bt_glyph_atlas_instance_data {
+  uint32_t atlas;
+  uint32_t glyph;
+};
+
+/*
+ * `glyph` is bt_glyph_atlas_none while the cell is unused. `prev` and `next`
+ * link the used cells from most to least recently used, `hash_next` the cells
+ * in the same bucket.
+ */
+struct bt_glyph_atlas_cell {
+  uint32_t glyph;
+  uint32_t size;
+  uint32_t generation;
+  uint32_t prev;
+  uint32_t next;
+  uint32_t hash_next;
+};
+
+/*
+ * Keeps small glyphs rasterized in a texture, so they're drawn with a texture
+ * lookup instead of their curves. Works like the glyph cache: glyphs get a
+ * cell when they're touched and the least recently used cells are reused when
+ * the atlas is full. The `pending` cells have to be rasterized before the
+ * glyphs are drawn, see bt_glyph_atlas_stage.
+ */
+struct bt_glyph_atlas {
+  struct bt_glyph_atlas_cell cells[bt_glyph_atlas_cell_count];
+  uint32_t buckets[bt_glyph_atlas_bucket_count];
+  uint32_t pending[bt_glyph_atlas_cell_count];
+  uint32_t pending_len;
+  uint32_t used_count;
+  uint32_t lru_head;
+  uint32_t lru_tail;
+  uint32_t generation;
+};
+
+void bt_glyph_atlas_init(struct bt_glyph_atlas atlas[static 1]);
+
+/*
+ * Index into bt_glyph_atlas_sizes for a glyph quad `pixels` wide on screen, or
+ * bt_glyph_atlas_none if it's too large for the atlas
+ */
+uint32_t bt_glyph_atlas_size(float pixels);
+/*
+ * Whether the bounds from bt_font_metrics fit the glyph quad, which is all of
+ * the glyph the atlas holds
+ */
+bool bt_glyph_atlas_fits(uint16_t const bounds[static 4]);
+
+/*
+ * Starts a new set of glyphs, see bt_glyph_cache_begin
+ */
+void bt_glyph_atlas_begin(struct bt_glyph_atlas atlas[static 1]);
+/*
+ * Returns the cell of the packed glyph at the given size, or
+ * bt_glyph_atlas_none if every cell is used by the current set
+ */
+uint32_t bt_glyph_atlas_touch(struct bt_glyph_atlas atlas[static 1],
+                              uint32_t packed_glyph, uint32_t size);
+/*
+ * Writes an instance per pending cell to `out`. Call
+ * bt_glyph_atlas_clear_pending once they're rasterized.
+ */
+void bt_glyph_atlas_stage(
+    struct bt_glyph_atlas const atlas[static 1],
+    struct bt_glyph_atlas_instance_data out[static bt_glyph_atlas_cell_count]);
+void bt_glyph_atlas_clear_pending(struct bt_glyph_atlas atlas[static 1]);
+
+#endif
@@ -0,0 +1,32 @@
+#version 460
+
+// Covers the atlas cell of each pending glyph, see glyph_atlas.h
+layout(location = 0) in uint in_atlas;
+layout(location = 1) in uint in_glyph;
+
+layout(location = 0) out vec2 out_uv;
+layout(location = 1) out vec3 out_color;
+layout(location = 2) flat out uint out_glyph;
+
+const float bt_glyph_atlas_texels = 2048.0;
+const uint bt_glyph_atlas_cell_texels = 64;
+const uint bt_glyph_atlas_cells_per_row = 32;
+const float bt_glyph_atlas_sizes[] = float[](8.0, 12.0, 16.0, 24.0, 32.0, 44.0, 62.0);
+const uint bt_glyph_atlas_size_shift = 16;
+const uint bt_glyph_atlas_cell_mask = (1u << bt_glyph_atlas_size_shift) - 1u;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1);
+    uint cell = in_atlas & bt_glyph_atlas_cell_mask;
+    float size = bt_glyph_atlas_sizes[in_atlas >> bt_glyph_atlas_size_shift];
+    vec2 texel = (vec2(cell % bt_glyph_atlas_cells_per_row, cell / bt_glyph_atlas_cells_per_row) + corner) * float(bt_glyph_atlas_cell_texels);
+    // The glyph quad is `size` texels wide and starts after a texel of
+    // padding. The whole cell is covered so that the rest of it is cleared.
+    out_uv = (corner * float(bt_glyph_atlas_cell_texels) - 1.0) / size;
+    out_color = vec3(1.0);
+    out_glyph = in_glyph;
+
+    // Texel rows go down like uv.y does
+    vec2 pos = texel / bt_glyph_atlas_texels * 2.0 - 1.0;
+    gl_Position = vec4(pos.x, -pos.y, 0.0, 1.0);
+}
@@ -0,0 +1,288 @@
+#include "glyph_cache.h"
+#include "logging.h"
+#include <SDL3/SDL_stdinc.h>
+
+/*
+ * What the GPU sees for glyphs that aren't resident: no curves and the empty
+ * bands every font pack starts with
+ */
+constexpr struct bt_font_curve_info bt_glyph_cache_empty_info = {
+    .start = 0,
+    .end = 0,
+    .band_start = 0,
+    .band_count = 1,
+};
+
+static struct bt_font_curve_info const *
+bt_glyph_cache_source_info(struct bt_glyph_cache const cache[static 1],
+                           uint32_t packed_glyph) {
+  struct bt_font const *font =
+      &cache->fonts->fonts[packed_glyph >> bt_font_stack_glyph_bits];
+  return &font->curve_infos[packed_glyph & bt_font_stack_glyph_mask];
+}
+
+static uint32_t bt_glyph_cache_entry_index(
+    struct bt_glyph_cache const cache[static 1], uint32_t packed_glyph) {
+  return cache->font_bases[packed_glyph >> bt_font_stack_glyph_bits] +
+         (packed_glyph & bt_font_stack_glyph_mask);
+}
+
+bool bt_glyph_cache_init(struct bt_glyph_cache cache[static 1],
+                         struct bt_font_stack const fonts[static 1],
+                         uint32_t budget) {
+  SDL_zerop(cache);
+
+  cache->fonts = fonts;
+  for (uint32_t i = 0; i < fonts->font_count; i += 1) {
+    cache->font_bases[i] = cache->entry_count;
+    cache->entry_count += fonts->fonts[i].curve_infos_len;
+  }
+  cache->page_count = budget / bt_glyph_cache_page_size;
+  if (cache->page_count == 0) {
+    BT_LOG_ERR("Glyph cache budget of %u bytes is too small", budget);
+    return false;
+  }
+
+  cache->entries = SDL_calloc(cache->entry_count, sizeof(*cache->entries));
+  cache->infos = SDL_calloc(cache->entry_count, sizeof(*cache->infos));
+  cache->pages_used = SDL_calloc(cache->page_count, sizeof(*cache->pages_used));
+  cache->pending = SDL_calloc(cache->entry_count, sizeof(*cache->pending));
+  if (!(cache->entries && cache->infos && cache->pages_used &&
+        cache->pending)) {
+    BT_LOG_SDL_FAIL("Failed to allocate glyph cache");
+    bt_glyph_cache_deinit(cache);
+    return false;
+  }
+
+  for (uint32_t font = 0; font < fonts->font_count; font += 1) {
+    for (uint32_t glyph = 0; glyph < fonts->fonts[font].curve_infos_len;
+         glyph += 1) {
+      uint32_t packed_glyph = font << bt_font_stack_glyph_bits | glyph;
+      uint32_t i = bt_glyph_cache_entry_index(cache, packed_glyph);
+      struct bt_font_curve_info const *source =
+          bt_glyph_cache_source_info(cache, packed_glyph);
+      cache->entries[i] = (struct bt_glyph_cache_entry){
+          .page = bt_glyph_cache_none,
+          .prev = bt_glyph_cache_none,
+          .next = bt_glyph_cache_none,
+      };
+      // Glyphs without curves, including composite glyphs, don't need any
+      // pages and are always resident
+      cache->infos[i] =
+          source->start == source->end ? *source : bt_glyph_cache_empty_info;
+    }
+  }
+  cache->lru_head = bt_glyph_cache_none;
+  cache->lru_tail = bt_glyph_cache_none;
+  cache->infos_dirty = true;
+
+  return true;
+}
+
+void bt_glyph_cache_deinit(struct bt_glyph_cache cache[static 1]) {
+  SDL_free(cache->entries);
+  SDL_free(cache->infos);
+  SDL_free(cache->pages_used);
+  SDL_free(cache->pending);
+  SDL_zerop(cache);
+}
+
+uint32_t bt_glyph_cache_curve_buffer_size(
+    struct bt_glyph_cache const cache[static 1]) {
+  return cache->page_count * bt_glyph_cache_page_size;
+}
+
+uint32_t bt_glyph_cache_staging_size(
+    struct bt_glyph_cache const cache[static 1]) {
+  return cache->entry_count * (uint32_t)sizeof(*cache->infos) +
+         bt_glyph_cache_curve_buffer_size(cache);
+}
+
+void bt_glyph_cache_begin(struct bt_glyph_cache cache[static 1]) {
+  cache->generation += 1;
+}
+
+static void bt_glyph_cache_unlink(struct bt_glyph_cache cache[static 1],
+                                  uint32_t i) {
+  struct bt_glyph_cache_entry *entry = &cache->entries[i];
+  if (entry->prev != bt_glyph_cache_none) {
+    cache->entries[entry->prev].next = entry->next;
+  } else {
+    cache->lru_head = entry->next;
+  }
+  if (entry->next != bt_glyph_cache_none) {
+    cache->entries[entry->next].prev = entry->prev;
+  } else {
+    cache->lru_tail = entry->prev;
+  }
+  entry->prev = bt_glyph_cache_none;
+  entry->next = bt_glyph_cache_none;
+}
+
+static void bt_glyph_cache_push_front(struct bt_glyph_cache cache[static 1],
+                                      uint32_t i) {
+  struct bt_glyph_cache_entry *entry = &cache->entries[i];
+  entry->next = cache->lru_head;
+  if (cache->lru_head != bt_glyph_cache_none) {
+    cache->entries[cache->lru_head].prev = i;
+  } else {
+    cache->lru_tail = i;
+  }
+  cache->lru_head = i;
+}
+
+/*
+ * Returns the first page of a run of `count` free pages, or
+ * bt_glyph_cache_none if there is none
+ */
+static uint32_t bt_glyph_cache_find_pages(
+    struct bt_glyph_cache const cache[static 1], uint32_t count) {
+  uint32_t run = 0;
+  for (uint32_t page = 0; page < cache->page_count; page += 1) {
+    run = cache->pages_used[page] ? 0 : run + 1;
+    if (run == count) {
+      return page + 1 - count;
+    }
+  }
+  return bt_glyph_cache_none;
+}
+
+static void bt_glyph_cache_set_pages(struct bt_glyph_cache cache[static 1],
+                                     uint32_t page, uint32_t count,
+                                     bool used) {
+  for (uint32_t i = page; i < page + count; i += 1) {
+    cache->pages_used[i] = used;
+  }
+}
+
+/*
+ * Evicts the least recently used glyph unless it belongs to the current set.
+ * Returns false if nothing could be evicted.
+ */
+static bool bt_glyph_cache_evict(struct bt_glyph_cache cache[static 1]) {
+  uint32_t i = cache->lru_tail;
+  if (i == bt_glyph_cache_none ||
+      cache->entries[i].generation == cache->generation) {
+    return false;
+  }
+
+  struct bt_glyph_cache_entry *entry = &cache->entries[i];
+  bt_glyph_cache_unlink(cache, i);
+  bt_glyph_cache_set_pages(cache, entry->page, entry->page_count, false);
+  entry->page = bt_glyph_cache_none;
+  entry->page_count = 0;
+  cache->infos[i] = bt_glyph_cache_empty_info;
+  cache->infos_dirty = true;
+  // Only if it was touched in an earlier set that hasn't been uploaded yet
+  for (uint32_t j = 0; j < cache->pending_len; j += 1) {
+    if (cache->pending[j] == i) {
+      cache->pending_len -= 1;
+      cache->pending[j] = cache->pending[cache->pending_len];
+      break;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Composite glyphs have no curves of their own and are always resident, but
+ * their components have to be resident too
+ */
+static bool bt_glyph_cache_touch_components(
+    struct bt_glyph_cache cache[static 1], uint32_t packed_glyph,
+    struct bt_font_curve_info const source[static 1]) {
+  uint32_t font = packed_glyph >> bt_font_stack_glyph_bits;
+  uint32_t const *components =
+      &cache->fonts->fonts[font].bands[source->band_start];
+  bool touched = true;
+  for (uint32_t i = 0; i < components[0]; i += 1) {
+    uint32_t component =
+        font << bt_font_stack_glyph_bits | components[1 + 2 * i];
+    touched = bt_glyph_cache_touch(cache, component) && touched;
+  }
+  return touched;
+}
+
+bool bt_glyph_cache_touch(struct bt_glyph_cache cache[static 1],
+                          uint32_t packed_glyph) {
+  struct bt_font_curve_info const *source =
+      bt_glyph_cache_source_info(cache, packed_glyph);
+  if (source->band_count == 0) {
+    return bt_glyph_cache_touch_components(cache, packed_glyph, source);
+  }
+
+  uint32_t i = bt_glyph_cache_entry_index(cache, packed_glyph);
+  struct bt_glyph_cache_entry *entry = &cache->entries[i];
+  entry->generation = cache->generation;
+
+  if (entry->page != bt_glyph_cache_none) {
+    bt_glyph_cache_unlink(cache, i);
+    bt_glyph_cache_push_front(cache, i);
+    return true;
+  }
+
+  uint32_t curve_count = source->end - source->start;
+  if (curve_count == 0) {
+    return true;
+  }
+
+  uint32_t page_count = (curve_count + bt_glyph_cache_page_curves - 1) /
+                        bt_glyph_cache_page_curves;
+  uint32_t page = bt_glyph_cache_find_pages(cache, page_count);
+  while (page == bt_glyph_cache_none) {
+    if (!bt_glyph_cache_evict(cache)) {
+      BT_LOG_ERR("Glyph cache is full, glyph %#x is not drawn", packed_glyph);
+      return false;
+    }
+    page = bt_glyph_cache_find_pages(cache, page_count);
+  }
+
+  bt_glyph_cache_set_pages(cache, page, page_count, true);
+  entry->page = page;
+  entry->page_count = page_count;
+  bt_glyph_cache_push_front(cache, i);
+
+  uint32_t start = page * bt_glyph_cache_page_curves;
+  cache->infos[i] = (struct bt_font_curve_info){
+      .start = start,
+      .end = start + curve_count,
+      .band_start = source->band_start,
+      .band_count = source->band_count,
+  };
+  cache->infos_dirty = true;
+  cache->pending[cache->pending_len] = i;
+  cache->pending_len += 1;
+
+  return true;
+}
+
+void bt_glyph_cache_stage(struct bt_glyph_cache const cache[static 1],
+                          unsigned char *out) {
+  size_t infos_size = cache->entry_count * sizeof(*cache->infos);
+  SDL_memcpy(out, cache->infos, infos_size);
+  out += infos_size;
+
+  for (uint32_t j = 0; j < cache->pending_len; j += 1) {
+    uint32_t i = cache->pending[j];
+    uint32_t font = cache->fonts->font_count - 1;
+    while (cache->font_bases[font] > i) {
+      font -= 1;
+    }
+    uint32_t packed_glyph =
+        font << bt_font_stack_glyph_bits | (i - cache->font_bases[font]);
+    struct bt_font_curve_info const *source =
+        bt_glyph_cache_source_info(cache, packed_glyph);
+    size_t size = (cache->infos[i].end - cache->infos[i].start) *
+                  sizeof(struct bt_font_curve);
+    size_t page_size = cache->entries[i].page_count * bt_glyph_cache_page_size;
+    SDL_memcpy(out, &cache->fonts->fonts[font].curves[source->start], size);
+    SDL_memset(out + size, 0, page_size - size);
+    out += page_size;
+  }
+}
+
+void bt_glyph_cache_clear_pending(struct bt_glyph_cache cache[static 1]) {
+  cache->pending_len = 0;
+  cache->infos_dirty = false;
+}
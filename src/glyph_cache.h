@@ -0,0 +1,98 @@
+#ifndef BT_GLYPH_CACHE_H
+#define BT_GLYPH_CACHE_H
+
+#include "font.h"
+
+/*
+ * The GPU curve buffer is split into pages of this many curves. A glyph takes
+ * a run of consecutive pages, so its curves stay contiguous.
+ */
+constexpr uint32_t bt_glyph_cache_page_curves = 32;
+constexpr uint32_t bt_glyph_cache_page_size =
+    bt_glyph_cache_page_curves * (uint32_t)sizeof(struct bt_font_curve);
+constexpr uint32_t bt_glyph_cache_none = UINT32_MAX;
+
+/*
+ * Indexed like the shared curve info buffer. `prev` and `next` link the
+ * resident glyphs from most to least recently used.
+ */
+struct bt_glyph_cache_entry {
+  uint32_t page;
+  uint32_t page_count;
+  uint32_t generation;
+  uint32_t prev;
+  uint32_t next;
+};
+
+/*
+ * Keeps the curves of the glyphs that are drawn in a fixed size GPU buffer
+ * instead of uploading every curve of every font. Glyphs are made resident
+ * when they are touched and the least recently used ones are evicted when the
+ * buffer is full.
+ *
+ * `infos` is what the curve info buffer should contain: resident glyphs point
+ * at their pages, the others have no curves and empty bands. Whenever
+ * `infos_dirty` is set, it and the curves of the `pending` glyphs have to be
+ * uploaded before drawing, see bt_glyph_cache_stage.
+ */
+struct bt_glyph_cache {
+  struct bt_font_stack const *fonts;
+  struct bt_glyph_cache_entry *entries;
+  struct bt_font_curve_info *infos;
+  bool *pages_used;
+  uint32_t *pending;
+  uint32_t font_bases[bt_font_stack_max_fonts];
+  uint32_t entry_count;
+  uint32_t page_count;
+  uint32_t pending_len;
+  uint32_t lru_head;
+  uint32_t lru_tail;
+  uint32_t generation;
+  bool infos_dirty;
+};
+
+/*
+ * `budget` is the size of the GPU curve buffer in bytes. Logs and returns
+ * false on failure, in which case `cache` doesn't need to be deinitialized.
+ */
+bool bt_glyph_cache_init(struct bt_glyph_cache cache[static 1],
+                         struct bt_font_stack const fonts[static 1],
+                         uint32_t budget);
+void bt_glyph_cache_deinit(struct bt_glyph_cache cache[static 1]);
+
+/*
+ * Size of the GPU curve buffer in bytes
+ */
+uint32_t bt_glyph_cache_curve_buffer_size(
+    struct bt_glyph_cache const cache[static 1]);
+/*
+ * Most bytes bt_glyph_cache_stage can write
+ */
+uint32_t bt_glyph_cache_staging_size(
+    struct bt_glyph_cache const cache[static 1]);
+
+/*
+ * Starts a new set of glyphs. Glyphs touched since the last call are never
+ * evicted for each other, so everything touched between two calls can be drawn
+ * together as long as it fits the budget.
+ */
+void bt_glyph_cache_begin(struct bt_glyph_cache cache[static 1]);
+/*
+ * Makes the packed glyph, or the components of a composite glyph, resident.
+ * Returns false if it doesn't fit next to the other glyphs of the current set,
+ * in which case whatever didn't fit is drawn empty.
+ */
+bool bt_glyph_cache_touch(struct bt_glyph_cache cache[static 1],
+                          uint32_t packed_glyph);
+/*
+ * Writes `infos` followed by the pages of the pending glyphs, in order, to
+ * `out`. Each glyph's curves fill its pages from the start and the rest of
+ * them is zeroed, so every glyph starts at a whole page. The pages of pending
+ * glyph i go to entries[pending[i]].page in the GPU curve buffer. Call
+ * bt_glyph_cache_clear_pending once they're uploaded.
+ */
+void bt_glyph_cache_stage(struct bt_glyph_cache const cache[static 1],
+                          unsigned char *out);
+void bt_glyph_cache_clear_pending(struct bt_glyph_cache cache[static 1]);
+
+#endif
@@ -5,8 +5,7 @@
 #include <SDL3/SDL_main.h>
 #include <locale.h>
 
-SDL_AppResult SDL_AppInit(void **appstate, [[maybe_unused]] int argc,
-                          [[maybe_unused]] char *argv[]) {
+SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
   bt_init_logger();
 
   SDL_SetAppMetadata("bigtime", "0.1.0", "org.remnantofcliff.bigtime");
@@ -26,7 +25,9 @@ SDL_AppResult SDL_AppInit(void **appstate, [[maybe_unused]] int argc,
     return SDL_APP_FAILURE;
   }
 
-  if (!bt_state_init(state)) {
+  // Optional font packs in fallback order to use instead of the default one
+  if (!bt_state_init(state, (uint32_t)(argc - 1),
+                     (char const *const *)&argv[1])) {
     return SDL_APP_FAILURE;
   }
 
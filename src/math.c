@@ -200,6 +200,55 @@ struct bt_vec4 bt_vec4_splat(float x) {
   return (struct bt_vec4){.arr = {x, x, x, x}};
 }
 
+uint16_t bt_half_from_float(float x) {
+  uint32_t bits = 0;
+  SDL_memcpy(&bits, &x, sizeof(bits));
+  uint32_t sign = bits >> 16 & 0x8000u;
+  uint32_t exponent = bits >> 23 & 0xFFu;
+  uint32_t mantissa = bits & 0x7FFFFFu;
+  if (exponent == 0xFFu) {
+    // Infinity, or NaN
+    return (uint16_t)(sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0u));
+  }
+  int32_t half_exponent = (int32_t)exponent - 127 + 15;
+  if (half_exponent >= 0x1F) {
+    return (uint16_t)(sign | 0x7C00u);
+  }
+  // The mantissa bits that don't fit, which round the rest
+  uint32_t shift = 13;
+  if (half_exponent <= 0) {
+    // Subnormal, with the implicit 1 moved into the mantissa
+    if (half_exponent < -10) {
+      return (uint16_t)sign;
+    }
+    mantissa |= 0x800000u;
+    shift = (uint32_t)(14 - half_exponent);
+    half_exponent = 0;
+  }
+  uint32_t half = sign | (uint32_t)half_exponent << 10 | mantissa >> shift;
+  uint32_t rest = mantissa & ((1u << shift) - 1);
+  uint32_t halfway = 1u << (shift - 1);
+  // A carry out of the mantissa goes into the exponent, which is right
+  if (rest > halfway || (rest == halfway && (half & 1) != 0)) {
+    half += 1;
+  }
+  return (uint16_t)half;
+}
+
+float bt_half_to_float(uint16_t x) {
+  uint32_t exponent = x >> 10 & 0x1Fu;
+  uint32_t mantissa = x & 0x3FFu;
+  float value;
+  if (exponent == 0) {
+    value = ldexpf((float)mantissa, -24);
+  } else if (exponent == 0x1F) {
+    value = mantissa != 0 ? NAN : INFINITY;
+  } else {
+    value = ldexpf((float)(mantissa | 0x400u), (int)exponent - 25);
+  }
+  return (x & 0x8000u) != 0 ? -value : value;
+}
+
 void bt_mat4_into_columns(struct bt_mat4 const in[static 1],
                           struct bt_vec4 out[restrict static 4]) {
   for (size_t i = 0; i < 4; i += 1) {
@@ -5,6 +5,8 @@
 #ifndef BT_MATH_H
 #define BT_MATH_H
 
+#include <stdint.h>
+
 struct bt_vec2 {
   union {
     float arr[2];
@@ -100,6 +102,13 @@ struct bt_vec4 bt_vec4_add(struct bt_vec4 a, struct bt_vec4 b);
 struct bt_vec4 bt_vec4_mul(struct bt_vec4 a, struct bt_vec4 b);
 struct bt_vec4 bt_vec4_splat(float x);
 
+/*
+ * IEEE 754 half precision floats, for vertex attributes. Rounds to nearest
+ * even, and values too large for a half become infinity.
+ */
+uint16_t bt_half_from_float(float x);
+float bt_half_to_float(uint16_t x);
+
 void bt_mat4_into_columns(struct bt_mat4 const in[static 1],
                           struct bt_vec4 out[restrict static 4]);
 void bt_mat4_mul_vec4(struct bt_mat4 const in1[static 1],
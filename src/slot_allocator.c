@@ -0,0 +1,117 @@
+#include "slot_allocator.h"
+#include "logging.h"
+#include <SDL3/SDL_stdinc.h>
+
+/*
+ * Free slots below bt_slot_allocator_end that make the allocator fragmented,
+ * as a fraction of the end, and at least this many of them
+ */
+constexpr uint32_t bt_slot_allocator_fragmented_divisor = 4;
+constexpr uint32_t bt_slot_allocator_fragmented_min = 16;
+
+bool bt_slot_allocator_init(struct bt_slot_allocator allocator[static 1],
+                            uint32_t slot_count) {
+  SDL_zerop(allocator);
+
+  allocator->free = SDL_calloc(slot_count / 2 + 1, sizeof(*allocator->free));
+  if (!allocator->free) {
+    BT_LOG_SDL_FAIL("Failed to allocate slot allocator");
+    return false;
+  }
+  allocator->slot_count = slot_count;
+  bt_slot_allocator_reset(allocator, 0);
+
+  return true;
+}
+
+void bt_slot_allocator_deinit(struct bt_slot_allocator allocator[static 1]) {
+  SDL_free(allocator->free);
+  SDL_zerop(allocator);
+}
+
+uint32_t bt_slot_allocator_alloc(struct bt_slot_allocator allocator[static 1],
+                                 uint32_t count) {
+  for (uint32_t i = 0; i < allocator->free_len; i += 1) {
+    struct bt_slot_range *range = &allocator->free[i];
+    if (range->count < count) {
+      continue;
+    }
+    uint32_t first = range->first;
+    range->first += count;
+    range->count -= count;
+    if (range->count == 0) {
+      SDL_memmove(range, range + 1,
+                  (allocator->free_len - i - 1) * sizeof(*range));
+      allocator->free_len -= 1;
+    }
+    allocator->free_count -= count;
+    return first;
+  }
+  return bt_slot_none;
+}
+
+void bt_slot_allocator_free(struct bt_slot_allocator allocator[static 1],
+                            uint32_t first, uint32_t count) {
+  allocator->free_count += count;
+
+  uint32_t i = 0;
+  while (i < allocator->free_len && allocator->free[i].first < first) {
+    i += 1;
+  }
+  struct bt_slot_range *prev = i > 0 ? &allocator->free[i - 1] : nullptr;
+  struct bt_slot_range *next =
+      i < allocator->free_len ? &allocator->free[i] : nullptr;
+  bool touches_prev = prev && prev->first + prev->count == first;
+  bool touches_next = next && first + count == next->first;
+
+  if (touches_prev && touches_next) {
+    prev->count += count + next->count;
+    SDL_memmove(next, next + 1,
+                (allocator->free_len - i - 1) * sizeof(*next));
+    allocator->free_len -= 1;
+  } else if (touches_prev) {
+    prev->count += count;
+  } else if (touches_next) {
+    next->first = first;
+    next->count += count;
+  } else {
+    SDL_memmove(&allocator->free[i + 1], &allocator->free[i],
+                (allocator->free_len - i) * sizeof(*allocator->free));
+    allocator->free[i] = (struct bt_slot_range){
+        .first = first,
+        .count = count,
+    };
+    allocator->free_len += 1;
+  }
+}
+
+uint32_t
+bt_slot_allocator_end(struct bt_slot_allocator const allocator[static 1]) {
+  if (allocator->free_len > 0) {
+    struct bt_slot_range const *last =
+        &allocator->free[allocator->free_len - 1];
+    if (last->first + last->count == allocator->slot_count) {
+      return last->first;
+    }
+  }
+  return allocator->slot_count;
+}
+
+bool bt_slot_allocator_fragmented(
+    struct bt_slot_allocator const allocator[static 1]) {
+  uint32_t end = bt_slot_allocator_end(allocator);
+  // The free slots that aren't after the end
+  uint32_t holes = allocator->free_count - (allocator->slot_count - end);
+  return holes >= bt_slot_allocator_fragmented_min &&
+         holes >= end / bt_slot_allocator_fragmented_divisor;
+}
+
+void bt_slot_allocator_reset(struct bt_slot_allocator allocator[static 1],
+                             uint32_t used_count) {
+  allocator->free_count = allocator->slot_count - used_count;
+  allocator->free_len = allocator->free_count > 0 ? 1 : 0;
+  allocator->free[0] = (struct bt_slot_range){
+      .first = used_count,
+      .count = allocator->free_count,
+  };
+}
@@ -0,0 +1,67 @@
+#ifndef BT_SLOT_ALLOCATOR_H
+#define BT_SLOT_ALLOCATOR_H
+
+#include <stdint.h>
+
+constexpr uint32_t bt_slot_none = UINT32_MAX;
+
+/*
+ * `count` slots in a row from `first`
+ */
+struct bt_slot_range {
+  uint32_t first;
+  uint32_t count;
+};
+
+/*
+ * Hands out runs of consecutive slots out of [0, slot_count), first fit, so
+ * the used slots stay packed towards the start. `free` holds the runs of free
+ * slots in order, and runs that touch are always merged into one, so there
+ * are at most half of the slots plus one of them.
+ */
+struct bt_slot_allocator {
+  struct bt_slot_range *free;
+  uint32_t free_len;
+  uint32_t free_count;
+  uint32_t slot_count;
+};
+
+/*
+ * Logs and returns false on failure, in which case `allocator` doesn't need to
+ * be deinitialized
+ */
+bool bt_slot_allocator_init(struct bt_slot_allocator allocator[static 1],
+                            uint32_t slot_count);
+void bt_slot_allocator_deinit(struct bt_slot_allocator allocator[static 1]);
+
+/*
+ * Returns the first of `count` free slots in a row, which are then used, or
+ * bt_slot_none if there isn't such a run. `count` can't be 0.
+ */
+uint32_t bt_slot_allocator_alloc(struct bt_slot_allocator allocator[static 1],
+                                 uint32_t count);
+/*
+ * Frees a run that bt_slot_allocator_alloc returned
+ */
+void bt_slot_allocator_free(struct bt_slot_allocator allocator[static 1],
+                            uint32_t first, uint32_t count);
+
+/*
+ * One past the last used slot
+ */
+uint32_t
+bt_slot_allocator_end(struct bt_slot_allocator const allocator[static 1]);
+/*
+ * Whether enough of the slots below bt_slot_allocator_end are free that the
+ * used runs should be moved down to the start, see bt_slot_allocator_reset
+ */
+bool bt_slot_allocator_fragmented(
+    struct bt_slot_allocator const allocator[static 1]);
+/*
+ * Makes the slots [0, used_count) used and the rest free, for once the caller
+ * has moved every used run down to the start
+ */
+void bt_slot_allocator_reset(struct bt_slot_allocator allocator[static 1],
+                             uint32_t used_count);
+
+#endif
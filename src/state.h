@@ -1,16 +1,25 @@
 #ifndef BT_STATE_H
 #define BT_STATE_H
 
+#include "font.h"
 #include "fps_timer.h"
 #include "game.h"
+#include "glyph_atlas.h"
+#include "glyph_cache.h"
+#include "slot_allocator.h"
 #include <SDL3/SDL_events.h>
 
 enum bt_gpu_buffer {
   bt_gpu_buffer_font_curve = 0,
   bt_gpu_buffer_font_curve_info,
+  bt_gpu_buffer_font_band,
+  bt_gpu_buffer_font_offsets,
+  bt_gpu_buffer_font_metrics,
   bt_gpu_buffer_vertex,
+  bt_gpu_buffer_text_run,
   bt_gpu_buffer_glyph2d_instance,
   bt_gpu_buffer_glyph3d_instance,
+  bt_gpu_buffer_glyph_atlas_instance,
   bt_gpu_buffer_index,
   bt_gpu_buffer_draw,
   /*
@@ -19,37 +28,243 @@ enum bt_gpu_buffer {
   bt_gpu_buffer_count,
 };
 
+/*
+ * Regions of the staging ring, one for each frame that can be in flight while
+ * the next one is recorded
+ */
+constexpr uint32_t bt_staging_frame_count = 3;
+
+/*
+ * Bytes [begin, end) of a buffer, empty if end <= begin
+ */
+struct bt_byte_range {
+  uint32_t begin;
+  uint32_t end;
+};
+
 enum bt_shader {
   bt_shader_glyph2d_vert = 0,
   bt_shader_glyph3d_vert,
   bt_shader_glyph_frag,
+  /*
+   * Variants of glyph.frag.glsl, see the defines at its top
+   */
+  bt_shader_glyph_dual_axis_frag,
+  bt_shader_glyph_fp16_frag,
+  bt_shader_glyph_fp16_aliased_frag,
+  bt_shader_glyph_linear_frag,
+  bt_shader_glyph_alpha_to_coverage_frag,
+  bt_shader_glyph_heatmap_frag,
+  bt_shader_glyph_dual_axis_heatmap_frag,
+  /*
+   * Variants that read the curves from textures, see bt_curve_storage
+   */
+  bt_shader_glyph_texture_frag,
+  bt_shader_glyph_dual_axis_texture_frag,
+  bt_shader_glyph_alpha_to_coverage_texture_frag,
+  /*
+   * Rasterize glyphs into the glyph atlas
+   */
+  bt_shader_glyph_atlas_vert,
+  bt_shader_glyph_atlas_frag,
+  bt_shader_glyph_atlas_texture_frag,
+  /*
+   * Draw the 2D text of the compute text2d mode over the window
+   */
+  bt_shader_text2d_composite_vert,
+  bt_shader_text2d_composite_frag,
   /*
    * Number of shaders
    */
   bt_shader_count,
 };
 
+/*
+ * Picks the glyph fragment shader variant of each render pipeline, from the
+ * best looking to the fastest. `reference` walks every curve of a glyph
+ * instead of using its bands, to check them against. `heatmap` draws how many
+ * curves each pixel of the `high` quality tests instead of the text, and adds
+ * them up in state->heatmap_texture.
+ */
+enum bt_glyph_quality {
+  bt_glyph_quality_high = 0,
+  bt_glyph_quality_medium,
+  bt_glyph_quality_low,
+  bt_glyph_quality_lowest,
+  bt_glyph_quality_reference,
+  bt_glyph_quality_heatmap,
+  /*
+   * Number of glyph qualities
+   */
+  bt_glyph_quality_count,
+};
+
 enum bt_render_pipeline {
   bt_render_pipeline_glyph2d = 0,
   bt_render_pipeline_glyph3d,
+  bt_render_pipeline_glyph_atlas,
+  bt_render_pipeline_text2d_composite,
   /*
    * Number of render pipelines
    */
   bt_render_pipeline_count,
 };
 
-struct bt_glyph2d_instance_data {
-  float scale[2];
-  float rotation;
-  float translation[2];
-  uint32_t c;
+/*
+ * How the 2D text is drawn. `raster` draws a quad per glyph. `compute` bins
+ * the glyphs into screen tiles, shades each tile once with only the glyphs
+ * that touch it and composites the result, see bt_state_render.
+ */
+enum bt_text2d_mode {
+  bt_text2d_mode_raster = 0,
+  bt_text2d_mode_compute,
+  /*
+   * Number of text2d modes
+   */
+  bt_text2d_mode_count,
 };
 
-struct bt_glyph3d_instance_data {
-  float scale[3];
-  float rotation[4];
+/*
+ * How the 3D text covers what's behind it. `discard` blends the glyph quads
+ * and discards their empty pixels, which keeps the depth test from running
+ * before the fragment shader. `msaa` renders them multisampled with alpha to
+ * coverage and no discard, front to back, so hidden glyph pixels fail the
+ * depth test before they're shaded.
+ */
+enum bt_text3d_mode {
+  bt_text3d_mode_discard = 0,
+  bt_text3d_mode_msaa,
+  /*
+   * Number of text3d modes
+   */
+  bt_text3d_mode_count,
+};
+
+/*
+ * Where the shaders read the curves and curve infos of the glyph cache from.
+ * `buffer` is a storage buffer of each. `texture` is an RGBA16UI texture of
+ * the grid points of the curves and an RGBA32UI texture of the curve infos,
+ * which some GPUs read through a better cache. Only the shaders of the high
+ * and medium glyph qualities have texture variants. The bands and font offsets
+ * are always in storage buffers.
+ */
+enum bt_curve_storage {
+  bt_curve_storage_buffer = 0,
+  bt_curve_storage_texture,
+  /*
+   * Number of curve storages
+   */
+  bt_curve_storage_count,
+};
+
+enum bt_compute_pipeline {
+  bt_compute_pipeline_text2d_bin = 0,
+  bt_compute_pipeline_text2d_tiles,
+  /*
+   * Number of compute pipelines
+   */
+  bt_compute_pipeline_count,
+};
+
+/*
+ * An outline around a glyph and a drop shadow under it, which the fragment
+ * shader draws in the same pass as the glyph. The width and the offset are in
+ * glyph quad units, with y down, and the shadow is the outlined glyph moved by
+ * `shadow_offset`. An outline with a width of 0 or either effect with a color
+ * alpha of 0 is off. Glyphs with effects are drawn from their curves. The
+ * width and the offset are half floats, see bt_half_from_float, which the
+ * shaders unpack in pairs with `padding`.
+ */
+struct bt_glyph_effects {
+  uint16_t outline_width;
+  uint16_t shadow_offset[2];
+  uint16_t padding;
+  uint8_t outline_color[4];
+  uint8_t shadow_color[4];
+};
+
+/*
+ * What every glyph of a text shares, one per text in the run buffer, at the
+ * index of the text. `translation` is where the first glyph's quad is
+ * centered, except that 2D runs leave out the x half of the quad, which the
+ * shaders add for the window's aspect ratio. 2D texts have their rotation in
+ * radians in rotation[0] and no translation[2], 3D ones a unit quaternion.
+ * The glyphs are scaled the same along both axes.
+ */
+struct bt_text_run_data {
   float translation[3];
-  uint32_t c;
+  float scale;
+  float rotation[4];
+  struct bt_glyph_effects effects;
+};
+
+/*
+ * Instances refer to their glyph with two 16 bit words. The first is the
+ * glyph's index within its font. The second has the font above
+ * bt_glyph_instance_font_shift and the glyph's atlas cell below, as
+ * size << bt_glyph_instance_size_shift | cell, or
+ * bt_glyph_instance_atlas_none, see bt_glyph_instance_ids.
+ */
+constexpr uint32_t bt_glyph_instance_font_shift = 13;
+constexpr uint32_t bt_glyph_instance_size_shift = 10;
+constexpr uint32_t bt_glyph_instance_atlas_none =
+    (1u << bt_glyph_instance_font_shift) - 1;
+/*
+ * Instances have the index of their run above bt_glyph_instance_run_shift, so
+ * there can be at most 1 << (32 - bt_glyph_instance_run_shift) texts, and how
+ * far the glyph is from the first one of its text below, in steps of
+ * bt_glyph_instance_advance_step glyph quads, see
+ * bt_glyph_instance_run_advance
+ */
+constexpr uint32_t bt_glyph_instance_run_shift = 22;
+constexpr uint32_t bt_glyph_instance_advance_mask =
+    (1u << bt_glyph_instance_run_shift) - 1;
+constexpr float bt_glyph_instance_advance_step = 1.0f / 1024.0f;
+
+/*
+ * A glyph of a 2D or 3D text. `glyph` is a packed glyph from
+ * bt_font_stack_glyph, not a codepoint, with its cell from
+ * bt_glyph_atlas_touch, see bt_glyph_instance_font_shift. The vertex shaders
+ * place it from its run and its advance, see bt_glyph_instance_run_shift, and
+ * fit the quad to its bounds from the font metrics buffer, grown by the
+ * effects of the run.
+ */
+struct bt_glyph_instance_data {
+  uint16_t glyph[2];
+  uint32_t run_advance;
+};
+
+/*
+ * Texts are drawn with the 2D pipeline, in normalized device coordinates, or
+ * the 3D one, in world units
+ */
+enum bt_text_kind {
+  bt_text_kind_2d = 0,
+  bt_text_kind_3d,
+
+  bt_text_kind_count,
+};
+
+/*
+ * As many as bt_glyph_instance_run_shift leaves room for
+ */
+constexpr uint32_t bt_text_max_count = 1024;
+constexpr uint32_t bt_text_none = UINT32_MAX;
+
+/*
+ * A text created with bt_text_create. Its glyphs are the `length` instances
+ * from `first` in the instance buffer of its kind, followed by unused ones up
+ * to `capacity`, which are the empty glyph 0. Where they are drawn is in its
+ * run, see bt_text_run_data.
+ */
+struct bt_text {
+  enum bt_text_kind kind;
+  float position[3];
+  float scale;
+  uint32_t first;
+  uint32_t capacity;
+  uint32_t length;
+  bool used;
 };
 
 typedef struct SDL_GPUDevice SDL_GPUDevice;
@@ -57,28 +272,103 @@ typedef struct SDL_GPUShader SDL_GPUShader;
 typedef struct SDL_GPUTransferBuffer SDL_GPUTransferBuffer;
 typedef struct SDL_GPUTexture SDL_GPUTexture;
 typedef struct SDL_GPUBuffer SDL_GPUBuffer;
+typedef struct SDL_GPUSampler SDL_GPUSampler;
 typedef struct SDL_GPUGraphicsPipeline SDL_GPUGraphicsPipeline;
+typedef struct SDL_GPUComputePipeline SDL_GPUComputePipeline;
+typedef struct SDL_GPUFence SDL_GPUFence;
 
 struct bt_state {
   SDL_Window *window;
   SDL_GPUDevice *gpu;
   SDL_GPUShader *shaders[bt_shader_count];
   SDL_GPUTransferBuffer *transfer_buffer;
+  SDL_GPUTransferBuffer *glyph_cache_transfer_buffer;
   SDL_GPUTexture *depth_texture;
+  SDL_GPUTexture *msaa_texture;
+  SDL_GPUTexture *heatmap_texture;
+  /*
+   * Where heatmap_texture is downloaded to when BT_HEATMAP_READBACK is set,
+   * and the fence of the download in flight
+   */
+  SDL_GPUTransferBuffer *heatmap_transfer_buffer;
+  SDL_GPUFence *heatmap_fence;
+  bool heatmap_readback;
+  bool heatmap_readback_due;
+  SDL_GPUTexture *glyph_atlas_texture;
+  /*
+   * The curves and curve infos of the texture curve storage, and the sampler
+   * they are bound with
+   */
+  SDL_GPUTexture *curve_texture;
+  SDL_GPUTexture *curve_info_texture;
+  SDL_GPUSampler *curve_sampler;
+  SDL_GPUSampler *glyph_atlas_sampler;
+  SDL_GPUTexture *text2d_texture;
+  SDL_GPUBuffer *text2d_tile_buffer;
+  uint32_t text2d_tile_count[2];
   SDL_GPUBuffer *buffers[bt_gpu_buffer_count];
   uint32_t buffer_sizes[bt_gpu_buffer_count];
   uint32_t transfer_buffer_offsets[bt_gpu_buffer_count];
+  /*
+   * The buffers that change after startup are written to `staging_data`
+   * first, at `staging_offsets`, and the bytes that changed since the last
+   * frame, `staging_dirty`, are copied to the next region of `staging_buffer`
+   * and uploaded from there. `staging_fences` are the fences of the uploads
+   * that last used each region.
+   */
+  SDL_GPUTransferBuffer *staging_buffer;
+  SDL_GPUFence *staging_fences[bt_staging_frame_count];
+  unsigned char *staging_data;
+  uint32_t staging_offsets[bt_gpu_buffer_count];
+  struct bt_byte_range staging_dirty[bt_gpu_buffer_count];
+  uint32_t staging_size;
+  uint32_t staging_frame;
   SDL_GPUGraphicsPipeline *render_pipelines[bt_render_pipeline_count];
+  SDL_GPUComputePipeline *compute_pipelines[bt_compute_pipeline_count];
+  enum bt_glyph_quality glyph_quality;
+  enum bt_text2d_mode text2d_mode;
+  enum bt_text3d_mode text3d_mode;
+  enum bt_curve_storage curve_storage;
+  /*
+   * The instances in front of the instance buffers that are drawn, up to the
+   * last slot used by a text
+   */
+  uint32_t glyph2d_instance_count;
+  uint32_t glyph3d_instance_count;
+  struct bt_text texts[bt_text_max_count];
+  struct bt_slot_allocator text_slots[bt_text_kind_count];
+  uint32_t fps_text;
+  uint32_t text3d;
+  struct bt_font_stack fonts;
+  struct bt_font_offsets font_offsets[bt_font_stack_max_fonts + 1];
+  struct bt_glyph_cache glyph_cache;
+  struct bt_glyph_atlas glyph_atlas;
   struct bt_fps_timer fps_timer;
-  struct bt_glyph2d_instance_data *glyph2d_instance_data;
-  struct bt_glyph3d_instance_data *glyph3d_instance_data;
+  struct bt_text_run_data *text_run_data;
+  struct bt_glyph_instance_data *glyph2d_instance_data;
+  struct bt_glyph_instance_data *glyph3d_instance_data;
   struct bt_game game;
   uint32_t width;
   uint32_t height;
 };
 
 // state_init.c
-bool bt_state_init(struct bt_state state[static 1]);
+/*
+ * `font_paths` are the font packs to load in fallback order. Without any, the
+ * default pack next to the executable is used. The glyph quality is read from
+ * the BT_GLYPH_QUALITY environment variable, which is one of high, medium,
+ * low, lowest, reference or heatmap, the text2d mode from BT_TEXT2D_MODE,
+ * which is raster or compute, and the text3d mode from BT_TEXT3D_MODE, which
+ * is discard or msaa. The heatmap quality always uses the raster and discard
+ * modes, and logs the curves tested in a frame every second if
+ * BT_HEATMAP_READBACK is set. The curve storage is read from
+ * BT_CURVE_STORAGE, which is buffer or texture. If BT_TEXT2D_BENCHMARK or
+ * BT_CURVE_STORAGE_BENCHMARK is set to a number of frames, the text2d modes or
+ * the curve storages are benchmarked first, see bt_state_benchmark_text2d and
+ * bt_state_benchmark_curve_storage.
+ */
+bool bt_state_init(struct bt_state state[static 1], uint32_t font_path_count,
+                   char const *const font_paths[]);
 void bt_state_deinit(struct bt_state state[static 1]);
 
 // state_events.c
@@ -90,5 +380,54 @@ void bt_state_handle_mouse_motion_event(
 
 // state_gfx.c
 bool bt_state_render(struct bt_state state[static 1]);
+/*
+ * Draws a window full of small overlapping 2D glyphs `frames` times with each
+ * text2d mode, off screen, and logs the time per frame of each
+ */
+bool bt_state_benchmark_text2d(struct bt_state state[static 1],
+                               uint32_t frames);
+/*
+ * Draws the same glyphs `frames` times with each curve storage that works with
+ * the glyph quality, and logs the time per frame of each. Leaves the curve
+ * storage as it was.
+ */
+bool bt_state_benchmark_curve_storage(struct bt_state state[static 1],
+                                      uint32_t frames);
+
+// state_text.c
+/*
+ * Creates an empty text that starts at `position`, the z of which is unused
+ * for 2D text, and whose glyphs are `scale` high.
+ * Returns bt_text_none if there are bt_text_max_count texts already. The
+ * functions below ignore texts that are bt_text_none or were destroyed.
+ */
+uint32_t bt_text_create(struct bt_state state[static 1],
+                        enum bt_text_kind kind,
+                        float const position[static 3], float scale);
+/*
+ * Replaces the characters of a text with the UTF-8 `string`. Only the
+ * instances of this text are rewritten, and uploaded with the next frame. The
+ * text keeps its slots unless it outgrows them. Logs and returns false if
+ * there aren't enough free slots left for it, in which case it's left empty.
+ * Also returns false for invalid texts, which are left alone.
+ */
+bool bt_text_set(struct bt_state state[static 1], uint32_t text,
+                 char const *string);
+/*
+ * Moves a text to start at `position`. Only its run is rewritten, not its
+ * glyphs. Invalid texts are ignored.
+ */
+void bt_text_move(struct bt_state state[static 1], uint32_t text,
+                  float const position[static 3]);
+/*
+ * Frees the slots of a text and its handle. Invalid texts are ignored.
+ */
+void bt_text_destroy(struct bt_state state[static 1], uint32_t text);
+/*
+ * Touches the glyphs of every text again, after bt_glyph_cache_begin and
+ * bt_glyph_atlas_begin, picks their atlas cells and sorts the glyphs of each
+ * 3D text for where the camera is now
+ */
+void bt_state_touch_texts(struct bt_state state[static 1]);
 
 #endif
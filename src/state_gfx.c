@@ -1,10 +1,10 @@
-#include "data.h"
 #include "logging.h"
 #include "state_private.h"
-#include <uchar.h>
 
-constexpr uint32_t bt_glyph2d_draw_offset = 0 * sizeof(*bt_draw_data_array);
-constexpr uint32_t bt_glyph3d_draw_offset = 1 * sizeof(*bt_draw_data_array);
+constexpr uint32_t bt_glyph2d_draw_offset =
+    bt_draw_glyph2d * sizeof(*bt_draw_data_array);
+constexpr uint32_t bt_glyph3d_draw_offset =
+    bt_draw_glyph3d * sizeof(*bt_draw_data_array);
 
 static void extrapolate_render_infos(struct bt_render_info info[static 1],
                                      struct bt_render_data out[static 1]) {
@@ -16,72 +16,142 @@ static void extrapolate_render_infos(struct bt_render_info info[static 1],
                    info->current_state.camera_pos, info->blend_factor);
 }
 
-static bool
-bt_state_copy_data_to_transfer_buffer(struct bt_state state[static 1],
-                                      uint32_t offset, size_t data_size,
-                                      unsigned char data[static data_size]) {
+static bool bt_state_wait_for_fence(struct bt_state state[static 1],
+                                    SDL_GPUFence *fence) {
+  bool result = SDL_WaitForGPUFences(state->gpu, true, &fence, 1);
+  if (!result) {
+    BT_LOG_SDL_FAIL("Failed to wait for fence");
+  }
+  SDL_ReleaseGPUFence(state->gpu, fence);
+  return result;
+}
+
+void bt_state_write_buffer(struct bt_state state[static 1],
+                           enum bt_gpu_buffer buffer, uint32_t offset,
+                           size_t data_size, void const *data) {
+  unsigned char const *src = data;
+  unsigned char *dst =
+      &state->staging_data[state->staging_offsets[buffer] + offset];
+  size_t begin = 0;
+  while (begin < data_size && dst[begin] == src[begin]) {
+    begin += 1;
+  }
+  if (begin == data_size) {
+    return;
+  }
+  size_t end = data_size;
+  while (dst[end - 1] == src[end - 1]) {
+    end -= 1;
+  }
+  SDL_memcpy(&dst[begin], &src[begin], end - begin);
+
+  struct bt_byte_range *dirty = &state->staging_dirty[buffer];
+  uint32_t dirty_begin = offset + (uint32_t)begin;
+  uint32_t dirty_end = offset + (uint32_t)end;
+  if (dirty->end <= dirty->begin) {
+    *dirty = (struct bt_byte_range){.begin = dirty_begin, .end = dirty_end};
+  } else {
+    dirty->begin = SDL_min(dirty->begin, dirty_begin);
+    dirty->end = SDL_max(dirty->end, dirty_end);
+  }
+}
+
+/*
+ * Uploads the dirty range of each buffer written with bt_state_write_buffer,
+ * with one copy each, from the next region of the staging ring. The region
+ * was last used bt_staging_frame_count flushes ago, and its upload is waited
+ * for first. Records into a command buffer of its own so that the region has
+ * a fence of its own. Does nothing when no buffer is dirty.
+ */
+static bool bt_state_flush_staging(struct bt_state state[static 1]) {
+  bool dirty = false;
+  for (enum bt_gpu_buffer i = 0; i < bt_gpu_buffer_count; i += 1) {
+    dirty = dirty ||
+            state->staging_dirty[i].end > state->staging_dirty[i].begin;
+  }
+  if (!dirty) {
+    return true;
+  }
+
+  uint32_t const frame = state->staging_frame;
+  if (state->staging_fences[frame]) {
+    SDL_GPUFence *fence = state->staging_fences[frame];
+    state->staging_fences[frame] = nullptr;
+    if (!bt_state_wait_for_fence(state, fence)) {
+      return false;
+    }
+  }
+
   unsigned char *p =
-      SDL_MapGPUTransferBuffer(state->gpu, state->transfer_buffer, true);
+      SDL_MapGPUTransferBuffer(state->gpu, state->staging_buffer, false);
   if (!p) {
-    BT_LOG_SDL_FAIL("Failed to map transfer buffer");
+    BT_LOG_SDL_FAIL("Failed to map staging buffer");
     return false;
   }
+  uint32_t const region = frame * state->staging_size;
+  for (enum bt_gpu_buffer i = 0; i < bt_gpu_buffer_count; i += 1) {
+    struct bt_byte_range const *range = &state->staging_dirty[i];
+    if (range->end > range->begin) {
+      uint32_t offset = state->staging_offsets[i] + range->begin;
+      SDL_memcpy(&p[region + offset], &state->staging_data[offset],
+                 range->end - range->begin);
+    }
+  }
+  SDL_UnmapGPUTransferBuffer(state->gpu, state->staging_buffer);
 
-  p += offset;
+  SDL_GPUCommandBuffer *command_buffer =
+      SDL_AcquireGPUCommandBuffer(state->gpu);
+  if (!command_buffer) {
+    BT_LOG_SDL_FAIL("Failed to acquire command buffer");
+    return false;
+  }
+  SDL_GPUCopyPass *const copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+  for (enum bt_gpu_buffer i = 0; i < bt_gpu_buffer_count; i += 1) {
+    struct bt_byte_range *range = &state->staging_dirty[i];
+    if (range->end <= range->begin) {
+      continue;
+    }
+    // Not cycled, the rest of the buffer is still what earlier frames drew
+    SDL_UploadToGPUBuffer(
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation){
+            .transfer_buffer = state->staging_buffer,
+            .offset = region + state->staging_offsets[i] + range->begin,
+        },
+        &(SDL_GPUBufferRegion){
+            .buffer = state->buffers[i],
+            .offset = range->begin,
+            .size = range->end - range->begin,
+        },
+        false);
+    *range = (struct bt_byte_range){};
+  }
+  SDL_EndGPUCopyPass(copy_pass);
 
-  SDL_memcpy(p, data, data_size);
-  SDL_UnmapGPUTransferBuffer(state->gpu, state->transfer_buffer);
+  state->staging_fences[frame] =
+      SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+  if (!state->staging_fences[frame]) {
+    BT_LOG_SDL_FAIL("Failed to submit command buffer");
+    return false;
+  }
+  state->staging_frame = (frame + 1) % bt_staging_frame_count;
 
   return true;
 }
 
-static void bt_state_update_glyph2d_instance_data(
-    struct bt_state state[static 1],
-    uint32_t const chars[static bt_glyph2d_max_instances]) {
-  float advance = 0.0f;
-  for (size_t i = 0; i < bt_glyph2d_max_instances; i += 1) {
-    struct bt_font_metrics const *metrics = &bt_font_metrics[chars[i]];
-    struct bt_glyph2d_instance_data *instance_data =
-        &state->glyph2d_instance_data[i];
-    float scale = 0.1f;
-    instance_data->scale[0] = scale;
-    instance_data->scale[1] = scale;
-    instance_data->rotation = 0.0f;
-    instance_data->translation[0] =
-        advance - 1.0f +
-        (0.5f * scale) * ((float)state->height / (float)state->width);
-    instance_data->translation[1] = 0.0f + 1.0f - 0.5f * scale;
-    instance_data->c = chars[i];
-    advance += metrics->advance * scale;
-  }
-}
-static void bt_state_update_glyph3d_instance_data(
-    struct bt_state state[static 1],
-    uint32_t const chars[static bt_glyph3d_max_instances]) {
-  float advance = 0.0f;
-  float scale = 1.0f;
-  for (size_t i = 0; i < bt_glyph3d_max_instances; i += 1) {
-    struct bt_font_metrics const *metrics = &bt_font_metrics[chars[i]];
-    struct bt_glyph3d_instance_data *instance_data =
-        &state->glyph3d_instance_data[i];
-    instance_data->scale[0] = scale;
-    instance_data->scale[1] = scale;
-    instance_data->scale[2] = 1.0f;
-    instance_data->rotation[0] = 0.0f;
-    instance_data->rotation[1] = 0.0f;
-    instance_data->rotation[2] = 0.0f;
-    instance_data->rotation[3] = 1.0f;
-    instance_data->translation[0] = advance * scale;
-    instance_data->translation[1] = 0.0f;
-    instance_data->translation[2] = 0.0f;
-    instance_data->c = chars[i];
-    advance += metrics->advance;
-  }
+void bt_state_update_draw_data(struct bt_state state[static 1]) {
+  SDL_GPUIndexedIndirectDrawCommand draw_data[bt_draw_count];
+  SDL_memcpy(draw_data, bt_draw_data_array, sizeof(draw_data));
+  draw_data[bt_draw_glyph2d].num_instances = state->glyph2d_instance_count;
+  draw_data[bt_draw_glyph3d].num_instances = state->glyph3d_instance_count;
+  bt_state_write_buffer(state, bt_gpu_buffer_draw, 0, sizeof(draw_data),
+                        draw_data);
 }
 
 struct bt_uniforms {
   alignas(16) struct bt_mat4 proj_view;
   float aspect_ratio;
+  float viewport_height;
 };
 
 static void bt_state_get_uniform_data(struct bt_state state[static 1],
@@ -99,74 +169,298 @@ static void bt_state_get_uniform_data(struct bt_state state[static 1],
              });
 
   out->aspect_ratio = (float)state->width / (float)state->height;
+  out->viewport_height = (float)state->height;
   struct bt_mat4 proj = {};
-  bt_perspective(&proj, bt_pi * 0.25f, out->aspect_ratio, 0.1f, 100.0f);
+  bt_perspective(&proj, bt_fov_y, out->aspect_ratio, bt_near_plane, 100.0f);
   bt_mat4_mul(&proj, &view, &out->proj_view);
 }
 
-static bool bt_state_update_fps(struct bt_state state[static 1]) {
+static void bt_state_update_fps(struct bt_state state[static 1]) {
   struct bt_fps_report report = {};
   bt_fps_timer_increment_fps(&state->fps_timer, &report);
   if (report.did_update) {
-    uint32_t chars2d[bt_glyph2d_max_instances] = {};
-    char temp[SDL_arraysize(chars2d)] = {};
+    state->heatmap_readback_due = state->heatmap_readback;
+    char temp[32] = {};
     SDL_snprintf(temp, SDL_arraysize(temp), "FPS: %" PRIu64, report.fps);
 
-    char *temp_p = temp;
-    char *temp_end = temp + SDL_arraysize(temp);
-    uint32_t *out_p = chars2d;
-    mbstate_t mbstate = {};
-    while (true) {
-      size_t n =
-          mbrtoc32(out_p, temp_p,
-                   (size_t)((uintptr_t)temp_end - (uintptr_t)temp_p), &mbstate);
-      if (n == 0) {
-        break;
-      }
-      if (n == (size_t)-1 || n == (size_t)-2) {
-        break;
-      }
-      temp_p += n;
-      out_p += 1;
-    }
-    bt_state_update_glyph2d_instance_data(state, chars2d);
+    bt_glyph_cache_begin(&state->glyph_cache);
+    bt_glyph_atlas_begin(&state->glyph_atlas);
+    bt_state_touch_texts(state);
+    bt_text_set(state, state->fps_text, temp);
+  }
+}
 
-    if (!bt_state_copy_data_to_transfer_buffer(
-            state,
-            state->transfer_buffer_offsets[bt_gpu_buffer_glyph2d_instance],
-            bt_glyph2d_max_instances * sizeof(*state->glyph2d_instance_data),
-            (unsigned char *)state->glyph2d_instance_data)) {
-      return false;
-    }
+/*
+ * Uploads what bt_glyph_cache_stage wrote to the glyph cache transfer buffer
+ * to the textures of the texture curve storage. The curve infos are uploaded
+ * as whole rows and then the rest of the last row, and the pages of each glyph
+ * a row at a time.
+ */
+static void
+bt_state_upload_glyph_cache_textures(struct bt_state state[static 1],
+                                     SDL_GPUCopyPass *copy_pass) {
+  struct bt_glyph_cache const *cache = &state->glyph_cache;
+  uint32_t rows = cache->entry_count / bt_curve_info_texture_width;
+  uint32_t rest = cache->entry_count % bt_curve_info_texture_width;
+  if (rows > 0) {
+    SDL_UploadToGPUTexture(
+        copy_pass,
+        &(SDL_GPUTextureTransferInfo){
+            .transfer_buffer = state->glyph_cache_transfer_buffer,
+            .offset = 0,
+        },
+        &(SDL_GPUTextureRegion){
+            .texture = state->curve_info_texture,
+            .w = bt_curve_info_texture_width,
+            .h = rows,
+            .d = 1,
+        },
+        false);
+  }
+  if (rest > 0) {
+    SDL_UploadToGPUTexture(
+        copy_pass,
+        &(SDL_GPUTextureTransferInfo){
+            .transfer_buffer = state->glyph_cache_transfer_buffer,
+            .offset = rows * bt_curve_info_texture_width *
+                      (uint32_t)sizeof(struct bt_font_curve_info),
+        },
+        &(SDL_GPUTextureRegion){
+            .texture = state->curve_info_texture,
+            .y = rows,
+            .w = rest,
+            .h = 1,
+            .d = 1,
+        },
+        false);
+  }
 
-    uint32_t chars3d[bt_glyph3d_max_instances] = U"3D TEXT TEST:D";
-    bt_state_update_glyph3d_instance_data(state, chars3d);
-    if (!bt_state_copy_data_to_transfer_buffer(
-            state,
-            state->transfer_buffer_offsets[bt_gpu_buffer_glyph3d_instance],
-            bt_glyph3d_max_instances * sizeof(*state->glyph3d_instance_data),
-            (unsigned char *)state->glyph3d_instance_data)) {
-      return false;
+  uint32_t offset =
+      cache->entry_count * (uint32_t)sizeof(struct bt_font_curve_info);
+  for (uint32_t i = 0; i < cache->pending_len; i += 1) {
+    struct bt_glyph_cache_entry const *entry =
+        &cache->entries[cache->pending[i]];
+    uint32_t end = entry->page + entry->page_count;
+    for (uint32_t page = entry->page; page < end;) {
+      uint32_t texel = page * bt_curve_texture_page_texels;
+      uint32_t x = texel % bt_curve_texture_width;
+      uint32_t pages =
+          SDL_min(end - page, (bt_curve_texture_width - x) /
+                                  bt_curve_texture_page_texels);
+      SDL_UploadToGPUTexture(
+          copy_pass,
+          &(SDL_GPUTextureTransferInfo){
+              .transfer_buffer = state->glyph_cache_transfer_buffer,
+              .offset = offset,
+          },
+          &(SDL_GPUTextureRegion){
+              .texture = state->curve_texture,
+              .x = x,
+              .y = texel / bt_curve_texture_width,
+              .w = pages * bt_curve_texture_page_texels,
+              .h = 1,
+              .d = 1,
+          },
+          false);
+      offset += pages * bt_glyph_cache_page_size;
+      page += pages;
     }
   }
+}
+
+/*
+ * Like bt_state_upload_glyph_cache_textures, for the curve buffers
+ */
+static void
+bt_state_upload_glyph_cache_buffers(struct bt_state state[static 1],
+                                    SDL_GPUCopyPass *copy_pass) {
+  struct bt_glyph_cache const *cache = &state->glyph_cache;
+  uint32_t offset = state->buffer_sizes[bt_gpu_buffer_font_curve_info];
+  SDL_UploadToGPUBuffer(
+      copy_pass,
+      &(SDL_GPUTransferBufferLocation){
+          .transfer_buffer = state->glyph_cache_transfer_buffer,
+          .offset = 0,
+      },
+      &(SDL_GPUBufferRegion){
+          .buffer = state->buffers[bt_gpu_buffer_font_curve_info],
+          .size = offset,
+      },
+      false);
+  for (uint32_t i = 0; i < cache->pending_len; i += 1) {
+    struct bt_glyph_cache_entry const *entry =
+        &cache->entries[cache->pending[i]];
+    uint32_t size = entry->page_count * bt_glyph_cache_page_size;
+    SDL_UploadToGPUBuffer(
+        copy_pass,
+        &(SDL_GPUTransferBufferLocation){
+            .transfer_buffer = state->glyph_cache_transfer_buffer,
+            .offset = offset,
+        },
+        &(SDL_GPUBufferRegion){
+            .buffer = state->buffers[bt_gpu_buffer_font_curve],
+            .offset = entry->page * bt_glyph_cache_page_size,
+            .size = size,
+        },
+        false);
+    offset += size;
+  }
+}
+
+/*
+ * Uploads the curves of the glyphs that became resident since the last frame
+ * and the curve infos pointing at them, in a copy pass of their own. Records
+ * nothing if there are none.
+ */
+static bool bt_state_upload_glyph_cache(struct bt_state state[static 1],
+                                        SDL_GPUCommandBuffer *command_buffer) {
+  struct bt_glyph_cache *cache = &state->glyph_cache;
+  if (!cache->infos_dirty) {
+    return true;
+  }
+
+  unsigned char *p = SDL_MapGPUTransferBuffer(
+      state->gpu, state->glyph_cache_transfer_buffer, true);
+  if (!p) {
+    BT_LOG_SDL_FAIL("Failed to map glyph cache transfer buffer");
+    return false;
+  }
+  bt_glyph_cache_stage(cache, p);
+  SDL_UnmapGPUTransferBuffer(state->gpu, state->glyph_cache_transfer_buffer);
+
+  SDL_GPUCopyPass *const copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+  if (state->curve_storage == bt_curve_storage_texture) {
+    bt_state_upload_glyph_cache_textures(state, copy_pass);
+  } else {
+    bt_state_upload_glyph_cache_buffers(state, copy_pass);
+  }
+  SDL_EndGPUCopyPass(copy_pass);
+  bt_glyph_cache_clear_pending(cache);
 
   return true;
 }
 
-static void
-bt_state_copy_transform_buffer_to_buffer(struct bt_state state[static 1],
-                                         SDL_GPUCopyPass *copy_pass,
-                                         enum bt_gpu_buffer buffer) {
-  SDL_UploadToGPUBuffer(copy_pass,
-                        &(SDL_GPUTransferBufferLocation){
-                            .transfer_buffer = state->transfer_buffer,
-                            .offset = state->transfer_buffer_offsets[buffer],
-                        },
-                        &(SDL_GPUBufferRegion){
-                            .buffer = state->buffers[buffer],
-                            .size = state->buffer_sizes[buffer],
-                        },
-                        true);
+/*
+ * The curve textures of the texture curve storage, which the shaders read
+ * with texelFetch
+ */
+static void bt_state_get_curve_texture_bindings(
+    struct bt_state const state[static 1],
+    SDL_GPUTextureSamplerBinding bindings[static 2]) {
+  bindings[0] = (SDL_GPUTextureSamplerBinding){
+      .texture = state->curve_texture,
+      .sampler = state->curve_sampler,
+  };
+  bindings[1] = (SDL_GPUTextureSamplerBinding){
+      .texture = state->curve_info_texture,
+      .sampler = state->curve_sampler,
+  };
+}
+
+/*
+ * Binds the font buffers of the fragment shader, after `sampler_count`
+ * samplers. With the texture curve storage, the curves and curve infos are
+ * the next two samplers and only the bands and font offsets are buffers.
+ */
+static void bt_state_bind_fonts(struct bt_state state[static 1],
+                                SDL_GPURenderPass *render_pass,
+                                uint32_t sampler_count) {
+  uint32_t first = bt_gpu_buffer_font_curve;
+  if (state->curve_storage == bt_curve_storage_texture) {
+    SDL_GPUTextureSamplerBinding bindings[2];
+    bt_state_get_curve_texture_bindings(state, bindings);
+    SDL_BindGPUFragmentSamplers(render_pass, sampler_count, bindings, 2);
+    first = bt_gpu_buffer_font_band;
+  }
+  SDL_BindGPUFragmentStorageBuffers(render_pass, 0, &state->buffers[first],
+                                    bt_gpu_buffer_font_offsets + 1 - first);
+}
+
+/*
+ * Writes an instance per atlas cell touched since the last frame, by the FPS
+ * update or any bt_text_set, for bt_state_render_glyph_atlas
+ */
+static void bt_state_stage_glyph_atlas(struct bt_state state[static 1]) {
+  struct bt_glyph_atlas *atlas = &state->glyph_atlas;
+  if (atlas->pending_len == 0) {
+    return;
+  }
+  struct bt_glyph_atlas_instance_data
+      atlas_instance_data[bt_glyph_atlas_cell_count];
+  bt_glyph_atlas_stage(atlas, atlas_instance_data);
+  bt_state_write_buffer(state, bt_gpu_buffer_glyph_atlas_instance, 0,
+                        atlas->pending_len * sizeof(*atlas_instance_data),
+                        atlas_instance_data);
+}
+
+/*
+ * Rasterizes the atlas cells touched since the last frame, which the text
+ * passes sample
+ */
+static void bt_state_render_glyph_atlas(struct bt_state state[static 1],
+                                        SDL_GPUCommandBuffer *command_buffer) {
+  struct bt_glyph_atlas *atlas = &state->glyph_atlas;
+  if (atlas->pending_len == 0) {
+    return;
+  }
+
+  SDL_GPURenderPass *render_pass =
+      SDL_BeginGPURenderPass(command_buffer,
+                             (SDL_GPUColorTargetInfo[]){
+                                 {
+                                     .texture = state->glyph_atlas_texture,
+                                     .load_op = SDL_GPU_LOADOP_LOAD,
+                                     .store_op = SDL_GPU_STOREOP_STORE,
+                                 },
+                             },
+                             1, nullptr);
+  SDL_BindGPUGraphicsPipeline(
+      render_pass, state->render_pipelines[bt_render_pipeline_glyph_atlas]);
+  SDL_BindGPUVertexBuffers(
+      render_pass, 0,
+      &(SDL_GPUBufferBinding){
+          .buffer = state->buffers[bt_gpu_buffer_glyph_atlas_instance],
+          .offset = 0,
+      },
+      1);
+  SDL_BindGPUIndexBuffer(render_pass,
+                         &(SDL_GPUBufferBinding){
+                             .buffer = state->buffers[bt_gpu_buffer_index],
+                             .offset = 0,
+                         },
+                         SDL_GPU_INDEXELEMENTSIZE_16BIT);
+  // The atlas shader has no atlas sampler of its own
+  bt_state_bind_fonts(state, render_pass, 0);
+  SDL_DrawGPUIndexedPrimitives(render_pass, 6, atlas->pending_len, 0, 0, 0);
+  SDL_EndGPURenderPass(render_pass);
+
+  bt_glyph_atlas_clear_pending(atlas);
+}
+
+/*
+ * Binds the runs and the font metrics and offsets the glyph vertex shaders
+ * place the glyphs with
+ */
+static void bt_state_bind_runs(struct bt_state state[static 1],
+                               SDL_GPURenderPass *render_pass) {
+  SDL_BindGPUVertexStorageBuffers(
+      render_pass, 0,
+      (SDL_GPUBuffer *const[]){
+          state->buffers[bt_gpu_buffer_text_run],
+          state->buffers[bt_gpu_buffer_font_metrics],
+          state->buffers[bt_gpu_buffer_font_offsets],
+      },
+      3);
+}
+
+static void bt_state_bind_glyph_atlas(struct bt_state state[static 1],
+                                      SDL_GPURenderPass *render_pass) {
+  SDL_BindGPUFragmentSamplers(render_pass, 0,
+                              &(SDL_GPUTextureSamplerBinding){
+                                  .texture = state->glyph_atlas_texture,
+                                  .sampler = state->glyph_atlas_sampler,
+                              },
+                              1);
 }
 
 static void bt_state_render_text2d(struct bt_state state[static 1],
@@ -192,13 +486,154 @@ static void bt_state_render_text2d(struct bt_state state[static 1],
                              .offset = 0,
                          },
                          SDL_GPU_INDEXELEMENTSIZE_16BIT);
-  SDL_BindGPUFragmentStorageBuffers(
-      render_pass, 0, &state->buffers[bt_gpu_buffer_font_curve], 2);
+  bt_state_bind_runs(state, render_pass);
+  bt_state_bind_glyph_atlas(state, render_pass);
+  bt_state_bind_fonts(state, render_pass, 1);
   SDL_DrawGPUIndexedPrimitivesIndirect(render_pass,
                                        state->buffers[bt_gpu_buffer_draw],
                                        bt_glyph2d_draw_offset, 1);
 }
 
+struct bt_text2d_uniforms {
+  uint32_t size[2];
+  uint32_t tile_count[2];
+  uint32_t instance_count;
+  float aspect_ratio;
+};
+
+/*
+ * Renders the 2D text into state->text2d_texture for the compute text2d mode.
+ * The bin pass lists every glyph in the tiles its quad touches, then the tiles
+ * pass shades each tile in one workgroup with only the glyphs listed in it.
+ */
+static void bt_state_compute_text2d(struct bt_state state[static 1],
+                                    SDL_GPUCommandBuffer *command_buffer,
+                                    float aspect_ratio) {
+  struct bt_text2d_uniforms uniform_data = {
+      .size = {state->width, state->height},
+      .tile_count = {state->text2d_tile_count[0],
+                     state->text2d_tile_count[1]},
+      .instance_count = state->glyph2d_instance_count,
+      .aspect_ratio = aspect_ratio,
+  };
+  SDL_PushGPUComputeUniformData(command_buffer, 0, &uniform_data,
+                                sizeof(uniform_data));
+
+  // Not cycled, the tiles pass leaves every tile empty for the next frame
+  SDL_GPUStorageBufferReadWriteBinding const tile_binding = {
+      .buffer = state->text2d_tile_buffer,
+      .cycle = false,
+  };
+  SDL_GPUComputePass *compute_pass =
+      SDL_BeginGPUComputePass(command_buffer, nullptr, 0, &tile_binding, 1);
+  SDL_BindGPUComputePipeline(
+      compute_pass, state->compute_pipelines[bt_compute_pipeline_text2d_bin]);
+  SDL_GPUBuffer *const bin_buffers[] = {
+      state->buffers[bt_gpu_buffer_glyph2d_instance],
+      state->buffers[bt_gpu_buffer_text_run],
+      state->buffers[bt_gpu_buffer_font_metrics],
+      state->buffers[bt_gpu_buffer_font_offsets],
+  };
+  SDL_BindGPUComputeStorageBuffers(compute_pass, 0, bin_buffers,
+                                   SDL_arraysize(bin_buffers));
+  // The tiles pass still runs without any glyphs, to clear the text
+  if (uniform_data.instance_count > 0) {
+    SDL_DispatchGPUCompute(compute_pass,
+                           (uniform_data.instance_count +
+                            bt_text2d_bin_group_size - 1) /
+                               bt_text2d_bin_group_size,
+                           1, 1);
+  }
+  SDL_EndGPUComputePass(compute_pass);
+
+  compute_pass = SDL_BeginGPUComputePass(
+      command_buffer,
+      &(SDL_GPUStorageTextureReadWriteBinding){
+          .texture = state->text2d_texture,
+          .cycle = true,
+      },
+      1, &tile_binding, 1);
+  SDL_BindGPUComputePipeline(
+      compute_pass,
+      state->compute_pipelines[bt_compute_pipeline_text2d_tiles]);
+  SDL_GPUBuffer *const tile_buffers[] = {
+      state->buffers[bt_gpu_buffer_font_curve],
+      state->buffers[bt_gpu_buffer_font_curve_info],
+      state->buffers[bt_gpu_buffer_font_band],
+      state->buffers[bt_gpu_buffer_font_offsets],
+      state->buffers[bt_gpu_buffer_glyph2d_instance],
+      state->buffers[bt_gpu_buffer_vertex],
+      state->buffers[bt_gpu_buffer_text_run],
+      state->buffers[bt_gpu_buffer_font_metrics],
+  };
+  // The texture curve storage has samplers instead of the first two
+  uint32_t first = 0;
+  if (state->curve_storage == bt_curve_storage_texture) {
+    SDL_GPUTextureSamplerBinding bindings[2];
+    bt_state_get_curve_texture_bindings(state, bindings);
+    SDL_BindGPUComputeSamplers(compute_pass, 0, bindings, 2);
+    first = 2;
+  }
+  SDL_BindGPUComputeStorageBuffers(compute_pass, 0, &tile_buffers[first],
+                                   SDL_arraysize(tile_buffers) - first);
+  SDL_DispatchGPUCompute(compute_pass, uniform_data.tile_count[0],
+                         uniform_data.tile_count[1], 1);
+  SDL_EndGPUComputePass(compute_pass);
+}
+
+static void bt_state_composite_text2d(struct bt_state state[static 1],
+                                      SDL_GPURenderPass *render_pass) {
+  SDL_BindGPUGraphicsPipeline(
+      render_pass,
+      state->render_pipelines[bt_render_pipeline_text2d_composite]);
+  SDL_BindGPUFragmentSamplers(render_pass, 0,
+                              &(SDL_GPUTextureSamplerBinding){
+                                  .texture = state->text2d_texture,
+                                  .sampler = state->glyph_atlas_sampler,
+                              },
+                              1);
+  SDL_DrawGPUPrimitives(render_pass, 3, 1, 0, 0);
+}
+
+/*
+ * Draws the 2D text over `target` with the given text2d mode. The vertex
+ * uniforms have to be pushed already.
+ */
+static void bt_state_draw_text2d(struct bt_state state[static 1],
+                                 SDL_GPUCommandBuffer *command_buffer,
+                                 SDL_GPUTexture *target,
+                                 enum bt_text2d_mode mode,
+                                 float aspect_ratio) {
+  if (mode == bt_text2d_mode_compute) {
+    bt_state_compute_text2d(state, command_buffer, aspect_ratio);
+  }
+
+  // The glyph quads add their curves to the heatmap of the 3D pass
+  bool const heatmap = mode == bt_text2d_mode_raster &&
+                       state->glyph_quality == bt_glyph_quality_heatmap;
+  SDL_GPURenderPass *render_pass =
+      SDL_BeginGPURenderPass(command_buffer,
+                             (SDL_GPUColorTargetInfo[]){
+                                 {
+                                     .texture = target,
+                                     .load_op = SDL_GPU_LOADOP_LOAD,
+                                     .store_op = SDL_GPU_STOREOP_STORE,
+                                 },
+                                 {
+                                     .texture = state->heatmap_texture,
+                                     .load_op = SDL_GPU_LOADOP_LOAD,
+                                     .store_op = SDL_GPU_STOREOP_STORE,
+                                 },
+                             },
+                             heatmap ? 2 : 1, nullptr);
+  if (mode == bt_text2d_mode_compute) {
+    bt_state_composite_text2d(state, render_pass);
+  } else {
+    bt_state_render_text2d(state, render_pass);
+  }
+  SDL_EndGPURenderPass(render_pass);
+}
+
 static void bt_state_render_text3d(struct bt_state state[static 1],
                                    SDL_GPURenderPass *render_pass) {
   SDL_BindGPUGraphicsPipeline(
@@ -222,17 +657,54 @@ static void bt_state_render_text3d(struct bt_state state[static 1],
                              .offset = 0,
                          },
                          SDL_GPU_INDEXELEMENTSIZE_16BIT);
-  SDL_BindGPUFragmentStorageBuffers(
-      render_pass, 0, &state->buffers[bt_gpu_buffer_font_curve], 2);
+  bt_state_bind_runs(state, render_pass);
+  bt_state_bind_glyph_atlas(state, render_pass);
+  bt_state_bind_fonts(state, render_pass, 1);
   SDL_DrawGPUIndexedPrimitivesIndirect(render_pass,
                                        state->buffers[bt_gpu_buffer_draw],
                                        bt_glyph3d_draw_offset, 1);
 }
 
+/*
+ * Logs the curves the glyphs tested in the frame whose heatmap was downloaded,
+ * once the GPU is done with it
+ */
+static void bt_state_poll_heatmap(struct bt_state state[static 1]) {
+  if (!state->heatmap_fence ||
+      !SDL_QueryGPUFence(state->gpu, state->heatmap_fence)) {
+    return;
+  }
+  SDL_ReleaseGPUFence(state->gpu, state->heatmap_fence);
+  state->heatmap_fence = nullptr;
+
+  float const *curves = SDL_MapGPUTransferBuffer(
+      state->gpu, state->heatmap_transfer_buffer, false);
+  if (!curves) {
+    BT_LOG_SDL_FAIL("Failed to map heatmap transfer buffer");
+    return;
+  }
+  uint64_t tested = 0;
+  uint64_t accepted = 0;
+  for (size_t i = 0; i < (size_t)state->width * state->height; i += 1) {
+    tested += (uint64_t)curves[i * 2];
+    accepted += (uint64_t)curves[i * 2 + 1];
+  }
+  SDL_UnmapGPUTransferBuffer(state->gpu, state->heatmap_transfer_buffer);
+  BT_LOG_INFO("Heatmap: %" PRIu64 " curves tested, %" PRIu64
+              " accepted in one frame",
+              tested, accepted);
+}
+
 bool bt_state_render(struct bt_state state[static 1]) {
+  bt_state_poll_heatmap(state);
+
   struct bt_uniforms uniform_data = {};
   bt_state_get_uniform_data(state, &uniform_data);
 
+  bt_state_stage_glyph_atlas(state);
+  if (!bt_state_flush_staging(state)) {
+    return false;
+  }
   SDL_GPUCommandBuffer *command_buffer =
       SDL_AcquireGPUCommandBuffer(state->gpu);
   if (!command_buffer) {
@@ -240,14 +712,10 @@ bool bt_state_render(struct bt_state state[static 1]) {
     return false;
   }
 
-  bool result = true;
+  bool result = bt_state_upload_glyph_cache(state, command_buffer);
+  bool download_heatmap = false;
 
-  SDL_GPUCopyPass *const copy_pass = SDL_BeginGPUCopyPass(command_buffer);
-  bt_state_copy_transform_buffer_to_buffer(state, copy_pass,
-                                           bt_gpu_buffer_glyph2d_instance);
-  bt_state_copy_transform_buffer_to_buffer(state, copy_pass,
-                                           bt_gpu_buffer_glyph3d_instance);
-  SDL_EndGPUCopyPass(copy_pass);
+  bt_state_render_glyph_atlas(state, command_buffer);
 
   uint32_t width;
   uint32_t height;
@@ -268,6 +736,21 @@ bool bt_state_render(struct bt_state state[static 1]) {
       SDL_ReleaseGPUTexture(state->gpu, state->depth_texture);
       state->depth_texture = new_texture;
     }
+    if (state->msaa_texture) {
+      new_texture = bt_create_msaa_texture(state);
+      if (new_texture) {
+        SDL_ReleaseGPUTexture(state->gpu, state->msaa_texture);
+        state->msaa_texture = new_texture;
+      }
+    }
+    if (!bt_create_text2d_targets(state)) {
+      result = false;
+      goto submit;
+    }
+    if (state->heatmap_texture && !bt_create_heatmap_targets(state)) {
+      result = false;
+      goto submit;
+    }
   }
 
   if (!texture) {
@@ -278,57 +761,77 @@ bool bt_state_render(struct bt_state state[static 1]) {
   SDL_PushGPUVertexUniformData(command_buffer, 1, &uniform_data,
                                sizeof(uniform_data));
 
-  SDL_GPURenderPass *render_pass =
-      SDL_BeginGPURenderPass(command_buffer,
-                             (SDL_GPUColorTargetInfo[]){
-                                 {
-                                     .texture = texture,
-                                     .clear_color =
-                                         (SDL_FColor){
-                                             .r = 0.0f,
-                                             .g = 0.0f,
-                                             .b = 0.0f,
-                                             .a = 1.0f,
-                                         },
-                                     .load_op = SDL_GPU_LOADOP_DONT_CARE,
-                                     .store_op = SDL_GPU_STOREOP_STORE,
-                                 },
-                             },
-                             1,
-                             &(SDL_GPUDepthStencilTargetInfo){
-                                 .texture = state->depth_texture,
-                                 .clear_depth = 1.0f,
-                                 .load_op = SDL_GPU_LOADOP_CLEAR,
-                                 .store_op = SDL_GPU_STOREOP_STORE,
-                                 .stencil_load_op = SDL_GPU_LOADOP_DONT_CARE,
-                                 .stencil_store_op = SDL_GPU_STOREOP_DONT_CARE,
-                                 .cycle = true,
-                                 .clear_stencil = 0.0f,
-                             });
+  // The msaa text3d mode renders into its multisampled texture and resolves it
+  // into the swapchain texture
+  bool msaa = state->text3d_mode == bt_text3d_mode_msaa;
+  SDL_GPURenderPass *render_pass = SDL_BeginGPURenderPass(
+      command_buffer,
+      (SDL_GPUColorTargetInfo[]){
+          {
+              .texture = msaa ? state->msaa_texture : texture,
+              .clear_color =
+                  (SDL_FColor){
+                      .r = 0.0f,
+                      .g = 0.0f,
+                      .b = 0.0f,
+                      .a = 1.0f,
+                  },
+              .load_op = msaa ? SDL_GPU_LOADOP_CLEAR : SDL_GPU_LOADOP_DONT_CARE,
+              .store_op =
+                  msaa ? SDL_GPU_STOREOP_RESOLVE : SDL_GPU_STOREOP_STORE,
+              .resolve_texture = msaa ? texture : nullptr,
+              .cycle = msaa,
+          },
+          {
+              .texture = state->heatmap_texture,
+              .load_op = SDL_GPU_LOADOP_CLEAR,
+              .store_op = SDL_GPU_STOREOP_STORE,
+          },
+      },
+      state->heatmap_texture ? 2 : 1,
+      &(SDL_GPUDepthStencilTargetInfo){
+          .texture = state->depth_texture,
+          .clear_depth = 1.0f,
+          .load_op = SDL_GPU_LOADOP_CLEAR,
+          .store_op = SDL_GPU_STOREOP_STORE,
+          .stencil_load_op = SDL_GPU_LOADOP_DONT_CARE,
+          .stencil_store_op = SDL_GPU_STOREOP_DONT_CARE,
+          .cycle = true,
+          .clear_stencil = 0.0f,
+      });
   bt_state_render_text3d(state, render_pass);
   SDL_EndGPURenderPass(render_pass);
-  render_pass =
-      SDL_BeginGPURenderPass(command_buffer,
-                             (SDL_GPUColorTargetInfo[]){
-                                 {
-                                     .texture = texture,
-                                     .clear_color =
-                                         (SDL_FColor){
-                                             .r = 0.0f,
-                                             .g = 0.0f,
-                                             .b = 0.0f,
-                                             .a = 1.0f,
-                                         },
-                                     .load_op = SDL_GPU_LOADOP_LOAD,
-                                     .store_op = SDL_GPU_STOREOP_STORE,
-                                 },
-                             },
-                             1, nullptr);
-  bt_state_render_text2d(state, render_pass);
-  SDL_EndGPURenderPass(render_pass);
+  bt_state_draw_text2d(state, command_buffer, texture, state->text2d_mode,
+                       uniform_data.aspect_ratio);
+
+  // Once per fps report, when the last download has been logged
+  download_heatmap = state->heatmap_readback_due && !state->heatmap_fence;
+  if (download_heatmap) {
+    SDL_GPUCopyPass *const heatmap_pass = SDL_BeginGPUCopyPass(command_buffer);
+    SDL_DownloadFromGPUTexture(
+        heatmap_pass,
+        &(SDL_GPUTextureRegion){
+            .texture = state->heatmap_texture,
+            .w = state->width,
+            .h = state->height,
+            .d = 1,
+        },
+        &(SDL_GPUTextureTransferInfo){
+            .transfer_buffer = state->heatmap_transfer_buffer,
+        });
+    SDL_EndGPUCopyPass(heatmap_pass);
+    state->heatmap_readback_due = false;
+  }
 
 submit:
-  if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+  if (download_heatmap) {
+    state->heatmap_fence =
+        SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+    if (!state->heatmap_fence) {
+      BT_LOG_SDL_FAIL("Failed to submit command buffer");
+      result = false;
+    }
+  } else if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
     BT_LOG_SDL_FAIL("Failed to submit command buffer");
     result = false;
   }
@@ -339,3 +842,255 @@ submit:
 
   return result;
 }
+
+/*
+ * Glyphs the text2d benchmarks draw, in the 2D instance slots. Each row of
+ * them is a run, in the runs of the texts that are created after the
+ * benchmarks, so there are at most as many runs as glyphs.
+ */
+constexpr uint32_t bt_text2d_benchmark_glyphs = 512;
+
+/*
+ * Rows of glyphs that overlap the rows above and below them, wrapping back to
+ * the top when they run off the bottom of the window
+ */
+static void bt_state_fill_benchmark_text2d(struct bt_state state[static 1]) {
+  constexpr float scale = 0.12f;
+  float aspect_ratio = (float)state->width / (float)state->height;
+  float line_height = 0.75f * scale * aspect_ratio;
+
+  bt_glyph_cache_begin(&state->glyph_cache);
+  uint32_t run = 0;
+  float advance = 0.0f;
+  float y = 1.0f;
+  for (size_t i = 0; i < bt_text2d_benchmark_glyphs; i += 1) {
+    // The printable ASCII characters
+    uint32_t glyph =
+        bt_font_stack_glyph(&state->fonts, U'!' + (uint32_t)(i % 94));
+    struct bt_font_metrics const *metrics =
+        bt_font_stack_metrics(&state->fonts, glyph);
+    if (i == 0 || advance * scale > 2.0f) {
+      if (i > 0) {
+        run += 1;
+        y = y - line_height < -1.0f ? 1.0f : y - line_height;
+      }
+      advance = 0.0f;
+      state->text_run_data[run] = (struct bt_text_run_data){
+          .translation = {-1.0f, y - 0.5f * scale * aspect_ratio},
+          .scale = scale,
+      };
+    }
+    struct bt_glyph_instance_data *instance_data =
+        &state->glyph2d_instance_data[i];
+    *instance_data = (struct bt_glyph_instance_data){
+        .run_advance = bt_glyph_instance_run_advance(run, advance),
+    };
+    bt_glyph_instance_ids(glyph, bt_glyph_atlas_none, instance_data->glyph);
+    bt_glyph_cache_touch(&state->glyph_cache, glyph);
+    advance += metrics->advance;
+  }
+  state->glyph2d_instance_count = bt_text2d_benchmark_glyphs;
+}
+
+/*
+ * Records and submits the 2D part of a frame into `target`. Acquires a fence
+ * for it if `fence` isn't null.
+ */
+static bool bt_state_benchmark_frame(struct bt_state state[static 1],
+                                     SDL_GPUTexture *target,
+                                     enum bt_text2d_mode mode,
+                                     SDL_GPUFence **fence) {
+  if (!bt_state_flush_staging(state)) {
+    return false;
+  }
+  SDL_GPUCommandBuffer *command_buffer =
+      SDL_AcquireGPUCommandBuffer(state->gpu);
+  if (!command_buffer) {
+    BT_LOG_SDL_FAIL("Failed to acquire command buffer");
+    return false;
+  }
+
+  bool result = bt_state_upload_glyph_cache(state, command_buffer);
+
+  // The 2D text only needs the aspect ratio
+  struct bt_uniforms uniform_data = {
+      .aspect_ratio = (float)state->width / (float)state->height,
+  };
+  SDL_PushGPUVertexUniformData(command_buffer, 1, &uniform_data,
+                               sizeof(uniform_data));
+  bt_state_draw_text2d(state, command_buffer, target, mode,
+                       uniform_data.aspect_ratio);
+
+  if (fence) {
+    *fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+    if (!*fence) {
+      BT_LOG_SDL_FAIL("Failed to submit command buffer");
+      return false;
+    }
+  } else if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+    BT_LOG_SDL_FAIL("Failed to submit command buffer");
+    return false;
+  }
+
+  return result;
+}
+
+/*
+ * The off screen target of the benchmarks, the size of the window
+ */
+static SDL_GPUTexture *
+bt_state_create_benchmark_target(struct bt_state state[static 1]) {
+  SDL_GPUTexture *target = SDL_CreateGPUTexture(
+      state->gpu,
+      &(SDL_GPUTextureCreateInfo){
+          .type = SDL_GPU_TEXTURETYPE_2D,
+          .format = SDL_GetGPUSwapchainTextureFormat(state->gpu, state->window),
+          .usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET,
+          .width = state->width,
+          .height = state->height,
+          .layer_count_or_depth = 1,
+          .num_levels = 1,
+          .sample_count = SDL_GPU_SAMPLECOUNT_1,
+      });
+  if (!target) {
+    BT_LOG_SDL_FAIL("Failed to create benchmark target");
+  }
+  return target;
+}
+
+static void bt_state_write_benchmark_text2d(struct bt_state state[static 1]) {
+  bt_state_write_buffer(state, bt_gpu_buffer_text_run, 0,
+                        bt_text2d_benchmark_glyphs *
+                            sizeof(*state->text_run_data),
+                        state->text_run_data);
+  bt_state_write_buffer(state, bt_gpu_buffer_glyph2d_instance, 0,
+                        state->glyph2d_instance_count *
+                            sizeof(*state->glyph2d_instance_data),
+                        state->glyph2d_instance_data);
+  bt_state_update_draw_data(state);
+}
+
+/*
+ * Back to the texts the first frames draw, which the benchmarks run before any
+ * are created
+ */
+static void bt_state_clear_benchmark_text2d(struct bt_state state[static 1]) {
+  SDL_memset(state->text_run_data, 0,
+             bt_text2d_benchmark_glyphs * sizeof(*state->text_run_data));
+  SDL_memset(state->glyph2d_instance_data, 0,
+             bt_text2d_benchmark_glyphs *
+                 sizeof(*state->glyph2d_instance_data));
+  bt_state_write_benchmark_text2d(state);
+  state->glyph2d_instance_count =
+      bt_slot_allocator_end(&state->text_slots[bt_text_kind_2d]);
+  bt_state_update_draw_data(state);
+}
+
+/*
+ * Draws one frame to upload the glyph curves and warm up the pipelines, then
+ * `frames` more, and sets `ms_per_frame` to the time each of those took
+ */
+static bool bt_state_time_benchmark(struct bt_state state[static 1],
+                                    SDL_GPUTexture *target,
+                                    enum bt_text2d_mode mode, uint32_t frames,
+                                    double ms_per_frame[static 1]) {
+  SDL_GPUFence *fence = nullptr;
+  if (!bt_state_benchmark_frame(state, target, mode, &fence) ||
+      !bt_state_wait_for_fence(state, fence)) {
+    return false;
+  }
+
+  uint64_t start = SDL_GetTicksNS();
+  for (uint32_t i = 0; i < frames; i += 1) {
+    if (!bt_state_benchmark_frame(state, target, mode,
+                                  i + 1 == frames ? &fence : nullptr)) {
+      return false;
+    }
+  }
+  if (!bt_state_wait_for_fence(state, fence)) {
+    return false;
+  }
+  uint64_t elapsed = SDL_GetTicksNS() - start;
+  *ms_per_frame = (double)elapsed / (double)frames / 1e6;
+  return true;
+}
+
+bool bt_state_benchmark_text2d(struct bt_state state[static 1],
+                               uint32_t frames) {
+  if (frames == 0) {
+    return true;
+  }
+
+  SDL_GPUTexture *target = bt_state_create_benchmark_target(state);
+  if (!target) {
+    return false;
+  }
+
+  bt_state_fill_benchmark_text2d(state);
+  bt_state_write_benchmark_text2d(state);
+  bool result = true;
+
+  for (enum bt_text2d_mode mode = 0; result && mode < bt_text2d_mode_count;
+       mode += 1) {
+    double ms_per_frame = 0.0;
+    result = bt_state_time_benchmark(state, target, mode, frames,
+                                     &ms_per_frame);
+    if (result) {
+      BT_LOG_INFO("text2d %s: %.3f ms per frame over %" PRIu32 " frames",
+                  bt_text2d_mode_names[mode], ms_per_frame, frames);
+    }
+  }
+
+  bt_state_clear_benchmark_text2d(state);
+  SDL_ReleaseGPUTexture(state->gpu, target);
+
+  return result;
+}
+
+bool bt_state_benchmark_curve_storage(struct bt_state state[static 1],
+                                      uint32_t frames) {
+  if (frames == 0) {
+    return true;
+  }
+
+  SDL_GPUTexture *target = bt_state_create_benchmark_target(state);
+  if (!target) {
+    return false;
+  }
+
+  enum bt_curve_storage const initial_storage = state->curve_storage;
+  bool result = true;
+  for (enum bt_curve_storage storage = 0;
+       result && storage < bt_curve_storage_count; storage += 1) {
+    if (!bt_curve_storage_supported(state, storage)) {
+      BT_LOG_INFO("curve storage %s: not supported at this glyph quality",
+                  bt_curve_storage_names[storage]);
+      continue;
+    }
+    // Switching empties the glyph cache, so the text is filled in again to
+    // make its glyphs resident in the new storage
+    result = bt_set_curve_storage(state, storage);
+    if (result) {
+      bt_state_fill_benchmark_text2d(state);
+      bt_state_write_benchmark_text2d(state);
+    }
+    double ms_per_frame = 0.0;
+    if (result) {
+      result = bt_state_time_benchmark(state, target, state->text2d_mode,
+                                       frames, &ms_per_frame);
+    }
+    if (result) {
+      BT_LOG_INFO("curve storage %s: %.3f ms per frame over %" PRIu32
+                  " frames",
+                  bt_curve_storage_names[storage], ms_per_frame, frames);
+    }
+  }
+
+  if (!bt_set_curve_storage(state, initial_storage)) {
+    result = false;
+  }
+  bt_state_clear_benchmark_text2d(state);
+  SDL_ReleaseGPUTexture(state->gpu, target);
+
+  return result;
+}
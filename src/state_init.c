@@ -24,38 +24,107 @@ constexpr struct bt_vertex_data bt_vertex_data_array[] = {
 };
 constexpr uint16_t bt_index_data_array[] = {0, 1, 2, 1, 3, 2};
 
+/*
+ * The buffers that are written after startup, through the staging ring
+ */
+constexpr bool bt_gpu_buffer_dynamic[bt_gpu_buffer_count] = {
+    [bt_gpu_buffer_text_run] = true,
+    [bt_gpu_buffer_glyph2d_instance] = true,
+    [bt_gpu_buffer_glyph3d_instance] = true,
+    [bt_gpu_buffer_glyph_atlas_instance] = true,
+    [bt_gpu_buffer_draw] = true,
+};
+
 static bool bt_create_buffers(struct bt_state state[static 1]) {
   constexpr SDL_GPUBufferUsageFlags bt_gpu_buffer_flags[] = {
-      [bt_gpu_buffer_font_curve] = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+      // The compute text2d mode reads the fonts, the runs, the 2D instances
+      // and the vertex colors too, and the glyph vertex shaders the font
+      // offsets, the metrics and the runs
+      [bt_gpu_buffer_font_curve] = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ |
+                                   SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
       [bt_gpu_buffer_font_curve_info] =
-          SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
-      [bt_gpu_buffer_vertex] = SDL_GPU_BUFFERUSAGE_VERTEX,
-      [bt_gpu_buffer_glyph2d_instance] = SDL_GPU_BUFFERUSAGE_VERTEX,
+          SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ |
+          SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+      [bt_gpu_buffer_font_band] = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ |
+                                  SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+      [bt_gpu_buffer_font_offsets] =
+          SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ |
+          SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+      [bt_gpu_buffer_font_metrics] =
+          SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ |
+          SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+      [bt_gpu_buffer_vertex] = SDL_GPU_BUFFERUSAGE_VERTEX |
+                               SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+      [bt_gpu_buffer_text_run] = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ |
+                                 SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
+      [bt_gpu_buffer_glyph2d_instance] =
+          SDL_GPU_BUFFERUSAGE_VERTEX | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ,
       [bt_gpu_buffer_glyph3d_instance] = SDL_GPU_BUFFERUSAGE_VERTEX,
+      [bt_gpu_buffer_glyph_atlas_instance] = SDL_GPU_BUFFERUSAGE_VERTEX,
       [bt_gpu_buffer_index] = SDL_GPU_BUFFERUSAGE_INDEX,
       [bt_gpu_buffer_draw] = SDL_GPU_BUFFERUSAGE_INDIRECT,
   };
   static char const *const bt_gpu_buffer_names[] = {
       [bt_gpu_buffer_font_curve] = "font curve buffer",
       [bt_gpu_buffer_font_curve_info] = "font curve info buffer",
+      [bt_gpu_buffer_font_band] = "font band buffer",
+      [bt_gpu_buffer_font_offsets] = "font offsets buffer",
+      [bt_gpu_buffer_font_metrics] = "font metrics buffer",
       [bt_gpu_buffer_vertex] = "vertex buffer",
+      [bt_gpu_buffer_text_run] = "text run buffer",
       [bt_gpu_buffer_glyph2d_instance] = "glyph2d instance buffer",
       [bt_gpu_buffer_glyph3d_instance] = "glyph3d instance buffer",
+      [bt_gpu_buffer_glyph_atlas_instance] = "glyph atlas instance buffer",
       [bt_gpu_buffer_index] = "index buffer",
       [bt_gpu_buffer_draw] = "draw buffer",
   };
 
-  state->buffer_sizes[bt_gpu_buffer_font_curve] = bt_font_curves_byte_size;
+  bt_font_stack_offsets(&state->fonts, state->font_offsets);
+  struct bt_font_offsets const *end =
+      &state->font_offsets[bt_font_stack_max_fonts];
+  state->buffer_sizes[bt_gpu_buffer_font_curve] =
+      bt_glyph_cache_curve_buffer_size(&state->glyph_cache);
   state->buffer_sizes[bt_gpu_buffer_font_curve_info] =
-      bt_font_curve_infos_byte_size;
+      (uint32_t)(end->curve_info * sizeof(struct bt_font_curve_info));
+  state->buffer_sizes[bt_gpu_buffer_font_band] =
+      (uint32_t)(end->band * sizeof(uint32_t));
+  state->buffer_sizes[bt_gpu_buffer_font_offsets] =
+      sizeof(state->font_offsets);
+  state->buffer_sizes[bt_gpu_buffer_font_metrics] =
+      (uint32_t)(end->metrics * sizeof(struct bt_font_metrics));
   state->buffer_sizes[bt_gpu_buffer_vertex] = sizeof(bt_vertex_data_array);
+  state->buffer_sizes[bt_gpu_buffer_text_run] =
+      bt_text_max_count * sizeof(*state->text_run_data);
   state->buffer_sizes[bt_gpu_buffer_glyph2d_instance] =
       bt_glyph2d_max_instances * sizeof(*state->glyph2d_instance_data);
   state->buffer_sizes[bt_gpu_buffer_glyph3d_instance] =
       bt_glyph3d_max_instances * sizeof(*state->glyph3d_instance_data);
+  state->buffer_sizes[bt_gpu_buffer_glyph_atlas_instance] =
+      bt_glyph_atlas_cell_count * sizeof(struct bt_glyph_atlas_instance_data);
   state->buffer_sizes[bt_gpu_buffer_index] = sizeof(bt_index_data_array);
   state->buffer_sizes[bt_gpu_buffer_draw] = sizeof(bt_draw_data_array);
 
+  state->staging_size = 0;
+  for (enum bt_gpu_buffer i = 0; i < bt_gpu_buffer_count; i += 1) {
+    state->staging_offsets[i] = state->staging_size;
+    if (bt_gpu_buffer_dynamic[i]) {
+      state->staging_size += state->buffer_sizes[i];
+    }
+  }
+  state->staging_data = SDL_calloc(1, state->staging_size);
+  if (!state->staging_data) {
+    BT_LOG_SDL_FAIL("Failed to allocate staging data");
+    return false;
+  }
+  state->staging_buffer = SDL_CreateGPUTransferBuffer(
+      state->gpu, &(SDL_GPUTransferBufferCreateInfo){
+                      .size = bt_staging_frame_count * state->staging_size,
+                  });
+  if (!state->staging_buffer) {
+    BT_LOG_SDL_FAIL("Failed to create staging buffer");
+    return false;
+  }
+
   state->transfer_buffer_offsets[0] = 0;
   for (enum bt_gpu_buffer i = 1; i < bt_gpu_buffer_count; i += 1) {
     state->transfer_buffer_offsets[i] =
@@ -75,6 +144,16 @@ static bool bt_create_buffers(struct bt_state state[static 1]) {
     return false;
   }
 
+  state->glyph_cache_transfer_buffer = SDL_CreateGPUTransferBuffer(
+      state->gpu,
+      &(SDL_GPUTransferBufferCreateInfo){
+          .size = bt_glyph_cache_staging_size(&state->glyph_cache),
+      });
+  if (!state->glyph_cache_transfer_buffer) {
+    BT_LOG_SDL_FAIL("Failed to create glyph cache transfer buffer");
+    return false;
+  }
+
   for (enum bt_gpu_buffer i = 0; i < bt_gpu_buffer_count; i += 1) {
     state->buffers[i] =
         SDL_CreateGPUBuffer(state->gpu, &(SDL_GPUBufferCreateInfo){
@@ -90,13 +169,49 @@ static bool bt_create_buffers(struct bt_state state[static 1]) {
   return true;
 }
 
+/*
+ * Concatenates the band sections of every font in the stack, copying straight
+ * from the mapped font packs
+ */
+static void bt_copy_font_bands(struct bt_font_stack const stack[static 1],
+                               unsigned char *p) {
+  for (uint32_t i = 0; i < stack->font_count; i += 1) {
+    struct bt_font const *font = &stack->fonts[i];
+    size_t size = font->bands_len * sizeof(*font->bands);
+    SDL_memcpy(p, font->bands, size);
+    p += size;
+  }
+}
+
+/*
+ * Concatenates the metrics sections of every font in the stack, like
+ * bt_copy_font_bands
+ */
+static void bt_copy_font_metrics(struct bt_font_stack const stack[static 1],
+                                 unsigned char *p) {
+  for (uint32_t i = 0; i < stack->font_count; i += 1) {
+    struct bt_font const *font = &stack->fonts[i];
+    size_t size = font->metrics_len * sizeof(*font->metrics);
+    SDL_memcpy(p, font->metrics, size);
+    p += size;
+  }
+}
+
 static bool bt_initialize_transfer_buffer(struct bt_state state[static 1]) {
+  // The curves are uploaded by the glyph cache as glyphs get drawn, and the
+  // bands and metrics are copied by bt_copy_font_bands and
+  // bt_copy_font_metrics
   void const *const data[] = {
-      [bt_gpu_buffer_font_curve] = bt_font_curves,
-      [bt_gpu_buffer_font_curve_info] = bt_font_curve_infos,
+      [bt_gpu_buffer_font_curve] = nullptr,
+      [bt_gpu_buffer_font_curve_info] = state->glyph_cache.infos,
+      [bt_gpu_buffer_font_band] = nullptr,
+      [bt_gpu_buffer_font_offsets] = state->font_offsets,
+      [bt_gpu_buffer_font_metrics] = nullptr,
       [bt_gpu_buffer_vertex] = bt_vertex_data_array,
+      [bt_gpu_buffer_text_run] = state->text_run_data,
       [bt_gpu_buffer_glyph2d_instance] = state->glyph2d_instance_data,
       [bt_gpu_buffer_glyph3d_instance] = state->glyph3d_instance_data,
+      [bt_gpu_buffer_glyph_atlas_instance] = nullptr,
       [bt_gpu_buffer_index] = bt_index_data_array,
       [bt_gpu_buffer_draw] = bt_draw_data_array,
   };
@@ -109,11 +224,31 @@ static bool bt_initialize_transfer_buffer(struct bt_state state[static 1]) {
   }
 
   for (enum bt_gpu_buffer i = 0; i < bt_gpu_buffer_count; i += 1) {
-    SDL_memcpy(p, data[i], state->buffer_sizes[i]);
+    if (data[i]) {
+      SDL_memcpy(p, data[i], state->buffer_sizes[i]);
+    } else if (i == bt_gpu_buffer_font_band) {
+      bt_copy_font_bands(&state->fonts, p);
+    } else if (i == bt_gpu_buffer_font_metrics) {
+      bt_copy_font_metrics(&state->fonts, p);
+    } else {
+      SDL_memset(p, 0, state->buffer_sizes[i]);
+    }
     p += state->buffer_sizes[i];
   }
+  // What the buffers that go through the staging ring start out as, which
+  // their later writes are compared with
+  for (enum bt_gpu_buffer i = 0; i < bt_gpu_buffer_count; i += 1) {
+    if (bt_gpu_buffer_dynamic[i] && data[i]) {
+      SDL_memcpy(&state->staging_data[state->staging_offsets[i]], data[i],
+                 state->buffer_sizes[i]);
+    }
+  }
 
   SDL_UnmapGPUTransferBuffer(state->gpu, state->transfer_buffer);
+  // The texture curve storage gets the curve infos with the first frame
+  if (state->curve_storage == bt_curve_storage_buffer) {
+    bt_glyph_cache_clear_pending(&state->glyph_cache);
+  }
 
   return true;
 }
@@ -170,36 +305,173 @@ static bool bt_create_shaders(struct bt_state state[static 1]) {
       [bt_shader_glyph2d_vert] = bt_glyph2d_vertex_spirv_byte_size,
       [bt_shader_glyph3d_vert] = bt_glyph3d_vertex_spirv_byte_size,
       [bt_shader_glyph_frag] = bt_glyph_fragment_spirv_byte_size,
+      [bt_shader_glyph_dual_axis_frag] =
+          bt_glyph_dual_axis_fragment_spirv_byte_size,
+      [bt_shader_glyph_fp16_frag] = bt_glyph_fp16_fragment_spirv_byte_size,
+      [bt_shader_glyph_fp16_aliased_frag] =
+          bt_glyph_fp16_aliased_fragment_spirv_byte_size,
+      [bt_shader_glyph_linear_frag] = bt_glyph_linear_fragment_spirv_byte_size,
+      [bt_shader_glyph_alpha_to_coverage_frag] =
+          bt_glyph_alpha_to_coverage_fragment_spirv_byte_size,
+      [bt_shader_glyph_heatmap_frag] =
+          bt_glyph_heatmap_fragment_spirv_byte_size,
+      [bt_shader_glyph_dual_axis_heatmap_frag] =
+          bt_glyph_dual_axis_heatmap_fragment_spirv_byte_size,
+      [bt_shader_glyph_texture_frag] =
+          bt_glyph_texture_fragment_spirv_byte_size,
+      [bt_shader_glyph_dual_axis_texture_frag] =
+          bt_glyph_dual_axis_texture_fragment_spirv_byte_size,
+      [bt_shader_glyph_alpha_to_coverage_texture_frag] =
+          bt_glyph_alpha_to_coverage_texture_fragment_spirv_byte_size,
+      [bt_shader_glyph_atlas_vert] = bt_glyph_atlas_vertex_spirv_byte_size,
+      [bt_shader_glyph_atlas_frag] = bt_glyph_atlas_fragment_spirv_byte_size,
+      [bt_shader_glyph_atlas_texture_frag] =
+          bt_glyph_atlas_texture_fragment_spirv_byte_size,
+      [bt_shader_text2d_composite_vert] =
+          bt_text2d_composite_vertex_spirv_byte_size,
+      [bt_shader_text2d_composite_frag] =
+          bt_text2d_composite_fragment_spirv_byte_size,
   };
   uint8_t const *const shader_sources[] = {
       [bt_shader_glyph2d_vert] = (uint8_t const *)bt_glyph2d_vertex_spirv,
       [bt_shader_glyph3d_vert] = (uint8_t const *)bt_glyph3d_vertex_spirv,
       [bt_shader_glyph_frag] = (uint8_t const *)bt_glyph_fragment_spirv,
+      [bt_shader_glyph_dual_axis_frag] =
+          (uint8_t const *)bt_glyph_dual_axis_fragment_spirv,
+      [bt_shader_glyph_fp16_frag] =
+          (uint8_t const *)bt_glyph_fp16_fragment_spirv,
+      [bt_shader_glyph_fp16_aliased_frag] =
+          (uint8_t const *)bt_glyph_fp16_aliased_fragment_spirv,
+      [bt_shader_glyph_linear_frag] =
+          (uint8_t const *)bt_glyph_linear_fragment_spirv,
+      [bt_shader_glyph_alpha_to_coverage_frag] =
+          (uint8_t const *)bt_glyph_alpha_to_coverage_fragment_spirv,
+      [bt_shader_glyph_heatmap_frag] =
+          (uint8_t const *)bt_glyph_heatmap_fragment_spirv,
+      [bt_shader_glyph_dual_axis_heatmap_frag] =
+          (uint8_t const *)bt_glyph_dual_axis_heatmap_fragment_spirv,
+      [bt_shader_glyph_texture_frag] =
+          (uint8_t const *)bt_glyph_texture_fragment_spirv,
+      [bt_shader_glyph_dual_axis_texture_frag] =
+          (uint8_t const *)bt_glyph_dual_axis_texture_fragment_spirv,
+      [bt_shader_glyph_alpha_to_coverage_texture_frag] =
+          (uint8_t const *)bt_glyph_alpha_to_coverage_texture_fragment_spirv,
+      [bt_shader_glyph_atlas_vert] =
+          (uint8_t const *)bt_glyph_atlas_vertex_spirv,
+      [bt_shader_glyph_atlas_frag] =
+          (uint8_t const *)bt_glyph_atlas_fragment_spirv,
+      [bt_shader_glyph_atlas_texture_frag] =
+          (uint8_t const *)bt_glyph_atlas_texture_fragment_spirv,
+      [bt_shader_text2d_composite_vert] =
+          (uint8_t const *)bt_text2d_composite_vertex_spirv,
+      [bt_shader_text2d_composite_frag] =
+          (uint8_t const *)bt_text2d_composite_fragment_spirv,
   };
   SDL_GPUShaderStage const shader_stages[] = {
       [bt_shader_glyph2d_vert] = SDL_GPU_SHADERSTAGE_VERTEX,
       [bt_shader_glyph3d_vert] = SDL_GPU_SHADERSTAGE_VERTEX,
       [bt_shader_glyph_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_dual_axis_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_fp16_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_fp16_aliased_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_linear_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_alpha_to_coverage_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_heatmap_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_dual_axis_heatmap_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_texture_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_dual_axis_texture_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_alpha_to_coverage_texture_frag] =
+          SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_atlas_vert] = SDL_GPU_SHADERSTAGE_VERTEX,
+      [bt_shader_glyph_atlas_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_glyph_atlas_texture_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
+      [bt_shader_text2d_composite_vert] = SDL_GPU_SHADERSTAGE_VERTEX,
+      [bt_shader_text2d_composite_frag] = SDL_GPU_SHADERSTAGE_FRAGMENT,
   };
+  // The glyph atlas, which the shader that renders into it can't sample, the
+  // curve textures of the texture variants and the 2D text of the compute
+  // text2d mode
   constexpr uint32_t sampler_counts[] = {
       [bt_shader_glyph2d_vert] = 0,
       [bt_shader_glyph3d_vert] = 0,
-      [bt_shader_glyph_frag] = 0,
+      [bt_shader_glyph_frag] = 1,
+      [bt_shader_glyph_dual_axis_frag] = 1,
+      [bt_shader_glyph_fp16_frag] = 1,
+      [bt_shader_glyph_fp16_aliased_frag] = 1,
+      [bt_shader_glyph_linear_frag] = 1,
+      [bt_shader_glyph_alpha_to_coverage_frag] = 1,
+      [bt_shader_glyph_heatmap_frag] = 1,
+      [bt_shader_glyph_dual_axis_heatmap_frag] = 1,
+      [bt_shader_glyph_texture_frag] = 3,
+      [bt_shader_glyph_dual_axis_texture_frag] = 3,
+      [bt_shader_glyph_alpha_to_coverage_texture_frag] = 3,
+      [bt_shader_glyph_atlas_vert] = 0,
+      [bt_shader_glyph_atlas_frag] = 0,
+      [bt_shader_glyph_atlas_texture_frag] = 2,
+      [bt_shader_text2d_composite_vert] = 0,
+      [bt_shader_text2d_composite_frag] = 1,
   };
   constexpr uint32_t storage_texture_counts[] = {
       [bt_shader_glyph2d_vert] = 0,
       [bt_shader_glyph3d_vert] = 0,
       [bt_shader_glyph_frag] = 0,
+      [bt_shader_glyph_dual_axis_frag] = 0,
+      [bt_shader_glyph_fp16_frag] = 0,
+      [bt_shader_glyph_fp16_aliased_frag] = 0,
+      [bt_shader_glyph_linear_frag] = 0,
+      [bt_shader_glyph_alpha_to_coverage_frag] = 0,
+      [bt_shader_glyph_heatmap_frag] = 0,
+      [bt_shader_glyph_dual_axis_heatmap_frag] = 0,
+      [bt_shader_glyph_texture_frag] = 0,
+      [bt_shader_glyph_dual_axis_texture_frag] = 0,
+      [bt_shader_glyph_alpha_to_coverage_texture_frag] = 0,
+      [bt_shader_glyph_atlas_vert] = 0,
+      [bt_shader_glyph_atlas_frag] = 0,
+      [bt_shader_glyph_atlas_texture_frag] = 0,
+      [bt_shader_text2d_composite_vert] = 0,
+      [bt_shader_text2d_composite_frag] = 0,
   };
+  // The glyph vertex shaders read the runs, the font metrics and the font
+  // offsets
   constexpr uint32_t storage_buffer_counts[] = {
-      [bt_shader_glyph2d_vert] = 0,
-      [bt_shader_glyph3d_vert] = 0,
-      [bt_shader_glyph_frag] = 2,
+      [bt_shader_glyph2d_vert] = 3,
+      [bt_shader_glyph3d_vert] = 3,
+      [bt_shader_glyph_frag] = 4,
+      [bt_shader_glyph_dual_axis_frag] = 4,
+      [bt_shader_glyph_fp16_frag] = 4,
+      [bt_shader_glyph_fp16_aliased_frag] = 4,
+      [bt_shader_glyph_linear_frag] = 4,
+      [bt_shader_glyph_alpha_to_coverage_frag] = 4,
+      [bt_shader_glyph_heatmap_frag] = 4,
+      [bt_shader_glyph_dual_axis_heatmap_frag] = 4,
+      [bt_shader_glyph_texture_frag] = 2,
+      [bt_shader_glyph_dual_axis_texture_frag] = 2,
+      [bt_shader_glyph_alpha_to_coverage_texture_frag] = 2,
+      [bt_shader_glyph_atlas_vert] = 0,
+      [bt_shader_glyph_atlas_frag] = 4,
+      [bt_shader_glyph_atlas_texture_frag] = 2,
+      [bt_shader_text2d_composite_vert] = 0,
+      [bt_shader_text2d_composite_frag] = 0,
   };
   constexpr uint32_t uniform_counts[] = {
       [bt_shader_glyph2d_vert] = 2,
       [bt_shader_glyph3d_vert] = 1,
       [bt_shader_glyph_frag] = 0,
+      [bt_shader_glyph_dual_axis_frag] = 0,
+      [bt_shader_glyph_fp16_frag] = 0,
+      [bt_shader_glyph_fp16_aliased_frag] = 0,
+      [bt_shader_glyph_linear_frag] = 0,
+      [bt_shader_glyph_alpha_to_coverage_frag] = 0,
+      [bt_shader_glyph_heatmap_frag] = 0,
+      [bt_shader_glyph_dual_axis_heatmap_frag] = 0,
+      [bt_shader_glyph_texture_frag] = 0,
+      [bt_shader_glyph_dual_axis_texture_frag] = 0,
+      [bt_shader_glyph_alpha_to_coverage_texture_frag] = 0,
+      [bt_shader_glyph_atlas_vert] = 0,
+      [bt_shader_glyph_atlas_frag] = 0,
+      [bt_shader_glyph_atlas_texture_frag] = 0,
+      [bt_shader_text2d_composite_vert] = 0,
+      [bt_shader_text2d_composite_frag] = 0,
   };
 
   for (enum bt_shader i = 0; i < bt_shader_count; i += 1) {
@@ -224,19 +496,115 @@ static bool bt_create_shaders(struct bt_state state[static 1]) {
   return true;
 }
 
+/*
+ * The variant of the fragment shader that reads the curves from the curve
+ * storage, if there is one. See bt_curve_storage_supported.
+ */
+static enum bt_shader
+bt_curve_storage_shader(struct bt_state const state[static 1],
+                        enum bt_shader shader) {
+  if (state->curve_storage == bt_curve_storage_buffer) {
+    return shader;
+  }
+  switch (shader) {
+  case bt_shader_glyph_frag:
+    return bt_shader_glyph_texture_frag;
+  case bt_shader_glyph_dual_axis_frag:
+    return bt_shader_glyph_dual_axis_texture_frag;
+  case bt_shader_glyph_alpha_to_coverage_frag:
+    return bt_shader_glyph_alpha_to_coverage_texture_frag;
+  case bt_shader_glyph_atlas_frag:
+    return bt_shader_glyph_atlas_texture_frag;
+  default:
+    return shader;
+  }
+}
+
+bool bt_curve_storage_supported(struct bt_state const state[static 1],
+                                enum bt_curve_storage storage) {
+  return storage == bt_curve_storage_buffer ||
+         state->glyph_quality == bt_glyph_quality_high ||
+         state->glyph_quality == bt_glyph_quality_medium;
+}
+
 static bool bt_create_render_pipelines(struct bt_state state[static 1]) {
   constexpr enum bt_shader vertex_shaders[] = {
       [bt_render_pipeline_glyph2d] = bt_shader_glyph2d_vert,
       [bt_render_pipeline_glyph3d] = bt_shader_glyph3d_vert,
+      [bt_render_pipeline_glyph_atlas] = bt_shader_glyph_atlas_vert,
+      [bt_render_pipeline_text2d_composite] = bt_shader_text2d_composite_vert,
   };
 
-  constexpr enum bt_shader fragment_shaders[] = {
-      [bt_render_pipeline_glyph2d] = bt_shader_glyph_frag,
-      [bt_render_pipeline_glyph3d] = bt_shader_glyph_frag,
-  };
+  /*
+   * 2D text is mostly small and axis aligned, where the dual axis shader
+   * antialiases the horizontal edges much better for twice the rays. Atlas
+   * cells are only rasterized once, so they always get the dual axis shader.
+   */
+  constexpr enum bt_shader
+      fragment_shaders[bt_glyph_quality_count][bt_render_pipeline_count] = {
+          [bt_glyph_quality_high] =
+              {
+                  [bt_render_pipeline_glyph2d] =
+                      bt_shader_glyph_dual_axis_frag,
+                  [bt_render_pipeline_glyph3d] = bt_shader_glyph_frag,
+                  [bt_render_pipeline_glyph_atlas] =
+                      bt_shader_glyph_atlas_frag,
+                  [bt_render_pipeline_text2d_composite] =
+                      bt_shader_text2d_composite_frag,
+              },
+          [bt_glyph_quality_medium] =
+              {
+                  [bt_render_pipeline_glyph2d] = bt_shader_glyph_frag,
+                  [bt_render_pipeline_glyph3d] = bt_shader_glyph_frag,
+                  [bt_render_pipeline_glyph_atlas] =
+                      bt_shader_glyph_atlas_frag,
+                  [bt_render_pipeline_text2d_composite] =
+                      bt_shader_text2d_composite_frag,
+              },
+          [bt_glyph_quality_low] =
+              {
+                  [bt_render_pipeline_glyph2d] = bt_shader_glyph_fp16_frag,
+                  [bt_render_pipeline_glyph3d] = bt_shader_glyph_fp16_frag,
+                  [bt_render_pipeline_glyph_atlas] =
+                      bt_shader_glyph_atlas_frag,
+                  [bt_render_pipeline_text2d_composite] =
+                      bt_shader_text2d_composite_frag,
+              },
+          [bt_glyph_quality_lowest] =
+              {
+                  [bt_render_pipeline_glyph2d] =
+                      bt_shader_glyph_fp16_aliased_frag,
+                  [bt_render_pipeline_glyph3d] =
+                      bt_shader_glyph_fp16_aliased_frag,
+                  [bt_render_pipeline_glyph_atlas] =
+                      bt_shader_glyph_atlas_frag,
+                  [bt_render_pipeline_text2d_composite] =
+                      bt_shader_text2d_composite_frag,
+              },
+          [bt_glyph_quality_reference] =
+              {
+                  [bt_render_pipeline_glyph2d] = bt_shader_glyph_linear_frag,
+                  [bt_render_pipeline_glyph3d] = bt_shader_glyph_linear_frag,
+                  [bt_render_pipeline_glyph_atlas] =
+                      bt_shader_glyph_atlas_frag,
+                  [bt_render_pipeline_text2d_composite] =
+                      bt_shader_text2d_composite_frag,
+              },
+          [bt_glyph_quality_heatmap] =
+              {
+                  [bt_render_pipeline_glyph2d] =
+                      bt_shader_glyph_dual_axis_heatmap_frag,
+                  [bt_render_pipeline_glyph3d] = bt_shader_glyph_heatmap_frag,
+                  [bt_render_pipeline_glyph_atlas] =
+                      bt_shader_glyph_atlas_frag,
+                  [bt_render_pipeline_text2d_composite] =
+                      bt_shader_text2d_composite_frag,
+              },
+      };
 
+  // The 2D and 3D glyphs only differ in their runs
   constexpr SDL_GPUVertexBufferDescription
-      glyph2d_vertex_buffer_descriptions[] = {
+      glyph_vertex_buffer_descriptions[] = {
           {
               .slot = 0,
               .pitch = sizeof(struct bt_vertex_data),
@@ -244,38 +612,38 @@ static bool bt_create_render_pipelines(struct bt_state state[static 1]) {
           },
           {
               .slot = 1,
-              .pitch = sizeof(struct bt_glyph2d_instance_data),
+              .pitch = sizeof(struct bt_glyph_instance_data),
               .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
           },
       };
 
   constexpr SDL_GPUVertexBufferDescription
-      glyph3d_vertex_buffer_descriptions[] = {
+      glyph_atlas_vertex_buffer_descriptions[] = {
           {
               .slot = 0,
-              .pitch = sizeof(struct bt_vertex_data),
-              .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-          },
-          {
-              .slot = 1,
-              .pitch = sizeof(struct bt_glyph3d_instance_data),
+              .pitch = sizeof(struct bt_glyph_atlas_instance_data),
               .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
           },
       };
 
   SDL_GPUVertexBufferDescription const *const vertex_buffer_descriptions[] = {
-      [bt_render_pipeline_glyph2d] = glyph2d_vertex_buffer_descriptions,
-      [bt_render_pipeline_glyph3d] = glyph3d_vertex_buffer_descriptions,
+      [bt_render_pipeline_glyph2d] = glyph_vertex_buffer_descriptions,
+      [bt_render_pipeline_glyph3d] = glyph_vertex_buffer_descriptions,
+      [bt_render_pipeline_glyph_atlas] = glyph_atlas_vertex_buffer_descriptions,
+      [bt_render_pipeline_text2d_composite] = nullptr,
   };
 
   constexpr uint32_t vertex_buffer_description_counts[] = {
       [bt_render_pipeline_glyph2d] =
-          SDL_arraysize(glyph2d_vertex_buffer_descriptions),
+          SDL_arraysize(glyph_vertex_buffer_descriptions),
       [bt_render_pipeline_glyph3d] =
-          SDL_arraysize(glyph3d_vertex_buffer_descriptions),
+          SDL_arraysize(glyph_vertex_buffer_descriptions),
+      [bt_render_pipeline_glyph_atlas] =
+          SDL_arraysize(glyph_atlas_vertex_buffer_descriptions),
+      [bt_render_pipeline_text2d_composite] = 0,
   };
 
-  constexpr SDL_GPUVertexAttribute glyph2d_vertex_attributes[] = {
+  constexpr SDL_GPUVertexAttribute glyph_vertex_attributes[] = {
       {
           .location = 0,
           .buffer_slot = 0,
@@ -285,84 +653,92 @@ static bool bt_create_render_pipelines(struct bt_state state[static 1]) {
       {
           .location = 1,
           .buffer_slot = 1,
-          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-          .offset = offsetof(typeof(*state->glyph2d_instance_data), scale),
+          .format = SDL_GPU_VERTEXELEMENTFORMAT_USHORT2,
+          .offset = offsetof(struct bt_glyph_instance_data, glyph),
       },
       {
           .location = 2,
           .buffer_slot = 1,
-          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,
-          .offset = offsetof(typeof(*state->glyph2d_instance_data), rotation),
-      },
-      {
-          .location = 3,
-          .buffer_slot = 1,
-          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-          .offset =
-              offsetof(typeof(*state->glyph2d_instance_data), translation),
-      },
-      {
-          .location = 4,
-          .buffer_slot = 1,
           .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT,
-          .offset = offsetof(typeof(*state->glyph2d_instance_data), c),
+          .offset = offsetof(struct bt_glyph_instance_data, run_advance),
       },
   };
-  constexpr SDL_GPUVertexAttribute glyph3d_vertex_attributes[] = {
+
+  constexpr SDL_GPUVertexAttribute glyph_atlas_vertex_attributes[] = {
       {
           .location = 0,
           .buffer_slot = 0,
-          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-          .offset = offsetof(struct bt_vertex_data, color),
+          .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT,
+          .offset = offsetof(struct bt_glyph_atlas_instance_data, atlas),
       },
       {
           .location = 1,
-          .buffer_slot = 1,
-          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-          .offset = offsetof(typeof(*state->glyph3d_instance_data), scale),
-      },
-      {
-          .location = 2,
-          .buffer_slot = 1,
-          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-          .offset = offsetof(typeof(*state->glyph3d_instance_data), rotation),
-      },
-      {
-          .location = 3,
-          .buffer_slot = 1,
-          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-          .offset =
-              offsetof(typeof(*state->glyph3d_instance_data), translation),
-      },
-      {
-          .location = 4,
-          .buffer_slot = 1,
+          .buffer_slot = 0,
           .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT,
-          .offset = offsetof(typeof(*state->glyph3d_instance_data), c),
+          .offset = offsetof(struct bt_glyph_atlas_instance_data, glyph),
       },
   };
 
   SDL_GPUVertexAttribute const *const vertex_attributes[] = {
-      [bt_render_pipeline_glyph2d] = glyph2d_vertex_attributes,
-      [bt_render_pipeline_glyph3d] = glyph3d_vertex_attributes,
+      [bt_render_pipeline_glyph2d] = glyph_vertex_attributes,
+      [bt_render_pipeline_glyph3d] = glyph_vertex_attributes,
+      [bt_render_pipeline_glyph_atlas] = glyph_atlas_vertex_attributes,
+      [bt_render_pipeline_text2d_composite] = nullptr,
   };
 
   constexpr uint32_t vertex_attribute_counts[] = {
-      [bt_render_pipeline_glyph2d] = SDL_arraysize(glyph2d_vertex_attributes),
-      [bt_render_pipeline_glyph3d] = SDL_arraysize(glyph3d_vertex_attributes),
+      [bt_render_pipeline_glyph2d] = SDL_arraysize(glyph_vertex_attributes),
+      [bt_render_pipeline_glyph3d] = SDL_arraysize(glyph_vertex_attributes),
+      [bt_render_pipeline_glyph_atlas] =
+          SDL_arraysize(glyph_atlas_vertex_attributes),
+      [bt_render_pipeline_text2d_composite] = 0,
   };
 
   constexpr bool enable_depths[] = {
       [bt_render_pipeline_glyph2d] = false,
       [bt_render_pipeline_glyph3d] = true,
+      [bt_render_pipeline_glyph_atlas] = false,
+      [bt_render_pipeline_text2d_composite] = false,
+  };
+
+  bool const msaa = state->text3d_mode == bt_text3d_mode_msaa;
+  // Atlas cells are written whole, including their coverage, and the alpha of
+  // the msaa text3d mode turns into the sample mask
+  bool const enable_blends[] = {
+      [bt_render_pipeline_glyph2d] = true,
+      [bt_render_pipeline_glyph3d] = !msaa,
+      [bt_render_pipeline_glyph_atlas] = false,
+      [bt_render_pipeline_text2d_composite] = true,
+  };
+
+  // The heatmap quality adds up the curves each pixel tests in a second target
+  bool const heatmap = state->glyph_quality == bt_glyph_quality_heatmap;
+  bool const heatmap_targets[] = {
+      [bt_render_pipeline_glyph2d] = heatmap,
+      [bt_render_pipeline_glyph3d] = heatmap,
+      [bt_render_pipeline_glyph_atlas] = false,
+      [bt_render_pipeline_text2d_composite] = false,
   };
 
-  SDL_GPUTextureFormat format =
+  SDL_GPUTextureFormat swapchain_format =
       SDL_GetGPUSwapchainTextureFormat(state->gpu, state->window);
+  SDL_GPUTextureFormat const formats[] = {
+      [bt_render_pipeline_glyph2d] = swapchain_format,
+      [bt_render_pipeline_glyph3d] = swapchain_format,
+      [bt_render_pipeline_glyph_atlas] = bt_glyph_atlas_format,
+      [bt_render_pipeline_text2d_composite] = swapchain_format,
+  };
   for (enum bt_render_pipeline i = 0; i < bt_render_pipeline_count; i += 1) {
+    // At every glyph quality in the msaa text3d mode, the other variants
+    // discard
+    enum bt_shader fragment_shader =
+        i == bt_render_pipeline_glyph3d && msaa
+            ? bt_shader_glyph_alpha_to_coverage_frag
+            : fragment_shaders[state->glyph_quality][i];
     SDL_GPUGraphicsPipelineCreateInfo create_info = {
         .vertex_shader = state->shaders[vertex_shaders[i]],
-        .fragment_shader = state->shaders[fragment_shaders[i]],
+        .fragment_shader =
+            state->shaders[bt_curve_storage_shader(state, fragment_shader)],
         .vertex_input_state =
             {
                 .vertex_buffer_descriptions = vertex_buffer_descriptions[i],
@@ -382,7 +758,7 @@ static bool bt_create_render_pipelines(struct bt_state state[static 1]) {
                 .color_target_descriptions =
                     (SDL_GPUColorTargetDescription[]){
                         {
-                            .format = format,
+                            .format = formats[i],
                             .blend_state =
                                 {
                                     .src_color_blendfactor =
@@ -395,11 +771,28 @@ static bool bt_create_render_pipelines(struct bt_state state[static 1]) {
                                     .dst_alpha_blendfactor =
                                         SDL_GPU_BLENDFACTOR_ZERO,
                                     .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+                                    .enable_blend = enable_blends[i],
+                                },
+                        },
+                        {
+                            .format = bt_heatmap_format,
+                            .blend_state =
+                                {
+                                    .src_color_blendfactor =
+                                        SDL_GPU_BLENDFACTOR_ONE,
+                                    .dst_color_blendfactor =
+                                        SDL_GPU_BLENDFACTOR_ONE,
+                                    .color_blend_op = SDL_GPU_BLENDOP_ADD,
+                                    .src_alpha_blendfactor =
+                                        SDL_GPU_BLENDFACTOR_ONE,
+                                    .dst_alpha_blendfactor =
+                                        SDL_GPU_BLENDFACTOR_ONE,
+                                    .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
                                     .enable_blend = true,
                                 },
                         },
                     },
-                .num_color_targets = 1,
+                .num_color_targets = heatmap_targets[i] ? 2 : 1,
             },
     };
     if (enable_depths[i]) {
@@ -412,6 +805,12 @@ static bool bt_create_render_pipelines(struct bt_state state[static 1]) {
       create_info.target_info.depth_stencil_format = bt_depth_format;
       create_info.target_info.has_depth_stencil_target = true;
     }
+    if (i == bt_render_pipeline_glyph3d && msaa) {
+      create_info.multisample_state = (SDL_GPUMultisampleState){
+          .sample_count = bt_text3d_msaa_sample_count,
+          .enable_alpha_to_coverage = true,
+      };
+    }
     state->render_pipelines[i] =
         SDL_CreateGPUGraphicsPipeline(state->gpu, &create_info);
     if (!state->render_pipelines[i]) {
@@ -423,6 +822,80 @@ static bool bt_create_render_pipelines(struct bt_state state[static 1]) {
   return true;
 }
 
+static bool bt_create_compute_pipelines(struct bt_state state[static 1]) {
+  bool const curve_texture =
+      state->curve_storage == bt_curve_storage_texture;
+  size_t const code_sizes[] = {
+      [bt_compute_pipeline_text2d_bin] = bt_text2d_bin_compute_spirv_byte_size,
+      [bt_compute_pipeline_text2d_tiles] =
+          curve_texture ? bt_text2d_tiles_texture_compute_spirv_byte_size
+                        : bt_text2d_tiles_compute_spirv_byte_size,
+  };
+  uint8_t const *const codes[] = {
+      [bt_compute_pipeline_text2d_bin] =
+          (uint8_t const *)bt_text2d_bin_compute_spirv,
+      [bt_compute_pipeline_text2d_tiles] =
+          curve_texture
+              ? (uint8_t const *)bt_text2d_tiles_texture_compute_spirv
+              : (uint8_t const *)bt_text2d_tiles_compute_spirv,
+  };
+  // The bin pass reads the 2D instances, the runs, the font metrics and the
+  // font offsets. The tiles pass reads the font buffers, or the curve textures
+  // and the other two font buffers, the 2D instances, the vertex colors, the
+  // runs and the font metrics, and writes the 2D text.
+  uint32_t const sampler_counts[] = {
+      [bt_compute_pipeline_text2d_bin] = 0,
+      [bt_compute_pipeline_text2d_tiles] = curve_texture ? 2 : 0,
+  };
+  uint32_t const readonly_storage_buffer_counts[] = {
+      [bt_compute_pipeline_text2d_bin] = 4,
+      [bt_compute_pipeline_text2d_tiles] = curve_texture ? 6 : 8,
+  };
+  constexpr uint32_t readwrite_storage_texture_counts[] = {
+      [bt_compute_pipeline_text2d_bin] = 0,
+      [bt_compute_pipeline_text2d_tiles] = 1,
+  };
+  constexpr uint32_t thread_counts[][2] = {
+      [bt_compute_pipeline_text2d_bin] = {bt_text2d_bin_group_size, 1},
+      [bt_compute_pipeline_text2d_tiles] = {bt_text2d_tile_size,
+                                            bt_text2d_tile_size},
+  };
+
+  for (enum bt_compute_pipeline i = 0; i < bt_compute_pipeline_count;
+       i += 1) {
+    state->compute_pipelines[i] = SDL_CreateGPUComputePipeline(
+        state->gpu,
+        &(SDL_GPUComputePipelineCreateInfo){
+            .code_size = code_sizes[i],
+            .code = codes[i],
+            .entrypoint = "main",
+            .format = SDL_GPU_SHADERFORMAT_SPIRV,
+            .num_samplers = sampler_counts[i],
+            .num_readonly_storage_buffers = readonly_storage_buffer_counts[i],
+            .num_readwrite_storage_textures =
+                readwrite_storage_texture_counts[i],
+            .num_readwrite_storage_buffers = 1,
+            .num_uniform_buffers = 1,
+            .threadcount_x = thread_counts[i][0],
+            .threadcount_y = thread_counts[i][1],
+            .threadcount_z = 1,
+        });
+    if (!state->compute_pipelines[i]) {
+      BT_LOG_SDL_FAIL("Failed to create compute pipeline");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static SDL_GPUSampleCount
+bt_text3d_sample_count(struct bt_state const state[static 1]) {
+  return state->text3d_mode == bt_text3d_mode_msaa
+             ? bt_text3d_msaa_sample_count
+             : SDL_GPU_SAMPLECOUNT_1;
+}
+
 SDL_GPUTexture *bt_create_depth_texture(struct bt_state state[static 1]) {
   SDL_GPUTexture *texture = SDL_CreateGPUTexture(
       state->gpu, &(SDL_GPUTextureCreateInfo){
@@ -433,7 +906,7 @@ SDL_GPUTexture *bt_create_depth_texture(struct bt_state state[static 1]) {
                       .height = state->height,
                       .layer_count_or_depth = 1,
                       .num_levels = 1,
-                      .sample_count = SDL_GPU_SAMPLECOUNT_1,
+                      .sample_count = bt_text3d_sample_count(state),
                   });
   if (!texture) {
     BT_LOG_SDL_FAIL("Failed to create depth texture");
@@ -442,17 +915,455 @@ SDL_GPUTexture *bt_create_depth_texture(struct bt_state state[static 1]) {
   return texture;
 }
 
-bool bt_state_init(struct bt_state state[static 1]) {
+SDL_GPUTexture *bt_create_msaa_texture(struct bt_state state[static 1]) {
+  SDL_GPUTexture *texture = SDL_CreateGPUTexture(
+      state->gpu,
+      &(SDL_GPUTextureCreateInfo){
+          .type = SDL_GPU_TEXTURETYPE_2D,
+          .format = SDL_GetGPUSwapchainTextureFormat(state->gpu, state->window),
+          .usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET,
+          .width = state->width,
+          .height = state->height,
+          .layer_count_or_depth = 1,
+          .num_levels = 1,
+          .sample_count = bt_text3d_msaa_sample_count,
+      });
+  if (!texture) {
+    BT_LOG_SDL_FAIL("Failed to create msaa texture");
+  }
+
+  return texture;
+}
+
+/*
+ * Uploads zeros over the whole buffer
+ */
+static bool bt_clear_gpu_buffer(struct bt_state state[static 1],
+                                SDL_GPUBuffer *buffer, uint32_t size) {
+  SDL_GPUTransferBuffer *transfer_buffer = SDL_CreateGPUTransferBuffer(
+      state->gpu, &(SDL_GPUTransferBufferCreateInfo){
+                      .size = size,
+                  });
+  if (!transfer_buffer) {
+    BT_LOG_SDL_FAIL("Failed to create transfer buffer");
+    return false;
+  }
+
+  bool result = false;
+  unsigned char *p =
+      SDL_MapGPUTransferBuffer(state->gpu, transfer_buffer, false);
+  if (!p) {
+    BT_LOG_SDL_FAIL("Failed to map transfer buffer");
+    goto release;
+  }
+  SDL_memset(p, 0, size);
+  SDL_UnmapGPUTransferBuffer(state->gpu, transfer_buffer);
+
+  SDL_GPUCommandBuffer *const command_buffer =
+      SDL_AcquireGPUCommandBuffer(state->gpu);
+  if (!command_buffer) {
+    BT_LOG_SDL_FAIL("Failed to create command buffer");
+    goto release;
+  }
+  SDL_GPUCopyPass *const copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+  SDL_UploadToGPUBuffer(copy_pass,
+                        &(SDL_GPUTransferBufferLocation){
+                            .transfer_buffer = transfer_buffer,
+                            .offset = 0,
+                        },
+                        &(SDL_GPUBufferRegion){
+                            .buffer = buffer,
+                            .size = size,
+                        },
+                        false);
+  SDL_EndGPUCopyPass(copy_pass);
+  if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+    BT_LOG_SDL_FAIL("Failed to submit command buffer");
+    goto release;
+  }
+  result = true;
+
+release:
+  // Only freed once the upload is done
+  SDL_ReleaseGPUTransferBuffer(state->gpu, transfer_buffer);
+  return result;
+}
+
+bool bt_create_text2d_targets(struct bt_state state[static 1]) {
+  SDL_GPUTexture *texture = SDL_CreateGPUTexture(
+      state->gpu, &(SDL_GPUTextureCreateInfo){
+                      .type = SDL_GPU_TEXTURETYPE_2D,
+                      .format = bt_text2d_format,
+                      .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER |
+                               SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE,
+                      .width = state->width,
+                      .height = state->height,
+                      .layer_count_or_depth = 1,
+                      .num_levels = 1,
+                      .sample_count = SDL_GPU_SAMPLECOUNT_1,
+                  });
+  if (!texture) {
+    BT_LOG_SDL_FAIL("Failed to create text2d texture");
+    return false;
+  }
+
+  uint32_t tile_count[2] = {
+      (state->width + bt_text2d_tile_size - 1) / bt_text2d_tile_size,
+      (state->height + bt_text2d_tile_size - 1) / bt_text2d_tile_size,
+  };
+  uint32_t size = tile_count[0] * tile_count[1] * bt_text2d_tile_stride *
+                  (uint32_t)sizeof(uint32_t);
+  SDL_GPUBuffer *tile_buffer = SDL_CreateGPUBuffer(
+      state->gpu, &(SDL_GPUBufferCreateInfo){
+                      .usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ |
+                               SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+                      .size = size,
+                  });
+  if (!tile_buffer) {
+    BT_LOG_SDL_FAIL("Failed to create text2d tile buffer");
+    SDL_ReleaseGPUTexture(state->gpu, texture);
+    return false;
+  }
+  // The tiles pass empties the tiles it reads, so they only start out empty
+  // here
+  if (!bt_clear_gpu_buffer(state, tile_buffer, size)) {
+    SDL_ReleaseGPUTexture(state->gpu, texture);
+    SDL_ReleaseGPUBuffer(state->gpu, tile_buffer);
+    return false;
+  }
+
+  if (state->text2d_texture) {
+    SDL_WaitForGPUIdle(state->gpu);
+    SDL_ReleaseGPUTexture(state->gpu, state->text2d_texture);
+    SDL_ReleaseGPUBuffer(state->gpu, state->text2d_tile_buffer);
+  }
+  state->text2d_texture = texture;
+  state->text2d_tile_buffer = tile_buffer;
+  state->text2d_tile_count[0] = tile_count[0];
+  state->text2d_tile_count[1] = tile_count[1];
+
+  return true;
+}
+
+bool bt_create_heatmap_targets(struct bt_state state[static 1]) {
+  SDL_GPUTexture *texture = SDL_CreateGPUTexture(
+      state->gpu, &(SDL_GPUTextureCreateInfo){
+                      .type = SDL_GPU_TEXTURETYPE_2D,
+                      .format = bt_heatmap_format,
+                      .usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET,
+                      .width = state->width,
+                      .height = state->height,
+                      .layer_count_or_depth = 1,
+                      .num_levels = 1,
+                      .sample_count = SDL_GPU_SAMPLECOUNT_1,
+                  });
+  if (!texture) {
+    BT_LOG_SDL_FAIL("Failed to create heatmap texture");
+    return false;
+  }
+
+  SDL_GPUTransferBuffer *transfer_buffer = nullptr;
+  if (state->heatmap_readback) {
+    transfer_buffer = SDL_CreateGPUTransferBuffer(
+        state->gpu,
+        &(SDL_GPUTransferBufferCreateInfo){
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD,
+            .size = state->width * state->height * 2 * (uint32_t)sizeof(float),
+        });
+    if (!transfer_buffer) {
+      BT_LOG_SDL_FAIL("Failed to create heatmap transfer buffer");
+      SDL_ReleaseGPUTexture(state->gpu, texture);
+      return false;
+    }
+  }
+
+  if (state->heatmap_texture) {
+    SDL_WaitForGPUIdle(state->gpu);
+    SDL_ReleaseGPUTexture(state->gpu, state->heatmap_texture);
+  }
+  if (state->heatmap_transfer_buffer) {
+    SDL_ReleaseGPUTransferBuffer(state->gpu, state->heatmap_transfer_buffer);
+  }
+  // The download in flight was for the old size
+  if (state->heatmap_fence) {
+    SDL_ReleaseGPUFence(state->gpu, state->heatmap_fence);
+    state->heatmap_fence = nullptr;
+  }
+  state->heatmap_texture = texture;
+  state->heatmap_transfer_buffer = transfer_buffer;
+
+  return true;
+}
+
+static bool bt_create_glyph_atlas(struct bt_state state[static 1]) {
+  state->glyph_atlas_texture = SDL_CreateGPUTexture(
+      state->gpu, &(SDL_GPUTextureCreateInfo){
+                      .type = SDL_GPU_TEXTURETYPE_2D,
+                      .format = bt_glyph_atlas_format,
+                      .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER |
+                               SDL_GPU_TEXTUREUSAGE_COLOR_TARGET,
+                      .width = bt_glyph_atlas_texels,
+                      .height = bt_glyph_atlas_texels,
+                      .layer_count_or_depth = 1,
+                      .num_levels = 1,
+                      .sample_count = SDL_GPU_SAMPLECOUNT_1,
+                  });
+  if (!state->glyph_atlas_texture) {
+    BT_LOG_SDL_FAIL("Failed to create glyph atlas texture");
+    return false;
+  }
+
+  state->glyph_atlas_sampler = SDL_CreateGPUSampler(
+      state->gpu, &(SDL_GPUSamplerCreateInfo){
+                      .min_filter = SDL_GPU_FILTER_LINEAR,
+                      .mag_filter = SDL_GPU_FILTER_LINEAR,
+                      .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST,
+                      .address_mode_u =
+                          SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+                      .address_mode_v =
+                          SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+                      .address_mode_w =
+                          SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+                  });
+  if (!state->glyph_atlas_sampler) {
+    BT_LOG_SDL_FAIL("Failed to create glyph atlas sampler");
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * The textures of the texture curve storage, sized like the curve buffer and
+ * the curve info buffer, and their sampler
+ */
+static bool bt_create_curve_textures(struct bt_state state[static 1]) {
+  uint32_t curve_texels =
+      bt_glyph_cache_curve_buffer_size(&state->glyph_cache) /
+      bt_curve_texture_texel_size;
+  state->curve_texture = SDL_CreateGPUTexture(
+      state->gpu,
+      &(SDL_GPUTextureCreateInfo){
+          .type = SDL_GPU_TEXTURETYPE_2D,
+          .format = bt_curve_texture_format,
+          .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER,
+          .width = bt_curve_texture_width,
+          .height = (curve_texels + bt_curve_texture_width - 1) /
+                    bt_curve_texture_width,
+          .layer_count_or_depth = 1,
+          .num_levels = 1,
+          .sample_count = SDL_GPU_SAMPLECOUNT_1,
+      });
+  if (!state->curve_texture) {
+    BT_LOG_SDL_FAIL("Failed to create curve texture");
+    return false;
+  }
+
+  uint32_t info_count = state->glyph_cache.entry_count;
+  state->curve_info_texture = SDL_CreateGPUTexture(
+      state->gpu,
+      &(SDL_GPUTextureCreateInfo){
+          .type = SDL_GPU_TEXTURETYPE_2D,
+          .format = bt_curve_info_texture_format,
+          .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER,
+          .width = bt_curve_info_texture_width,
+          .height = (info_count + bt_curve_info_texture_width - 1) /
+                    bt_curve_info_texture_width,
+          .layer_count_or_depth = 1,
+          .num_levels = 1,
+          .sample_count = SDL_GPU_SAMPLECOUNT_1,
+      });
+  if (!state->curve_info_texture) {
+    BT_LOG_SDL_FAIL("Failed to create curve info texture");
+    return false;
+  }
+
+  // Only read with texelFetch, but integer textures can't be bound with a
+  // linear filter
+  state->curve_sampler = SDL_CreateGPUSampler(
+      state->gpu, &(SDL_GPUSamplerCreateInfo){
+                      .min_filter = SDL_GPU_FILTER_NEAREST,
+                      .mag_filter = SDL_GPU_FILTER_NEAREST,
+                      .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST,
+                      .address_mode_u =
+                          SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+                      .address_mode_v =
+                          SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+                      .address_mode_w =
+                          SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+                  });
+  if (!state->curve_sampler) {
+    BT_LOG_SDL_FAIL("Failed to create curve sampler");
+    return false;
+  }
+
+  return true;
+}
+
+static void bt_release_pipelines(struct bt_state state[static 1]) {
+  for (enum bt_render_pipeline i = 0; i < bt_render_pipeline_count; i += 1) {
+    if (state->render_pipelines[i]) {
+      SDL_ReleaseGPUGraphicsPipeline(state->gpu, state->render_pipelines[i]);
+      state->render_pipelines[i] = nullptr;
+    }
+  }
+  for (enum bt_compute_pipeline i = 0; i < bt_compute_pipeline_count;
+       i += 1) {
+    if (state->compute_pipelines[i]) {
+      SDL_ReleaseGPUComputePipeline(state->gpu, state->compute_pipelines[i]);
+      state->compute_pipelines[i] = nullptr;
+    }
+  }
+}
+
+bool bt_set_curve_storage(struct bt_state state[static 1],
+                          enum bt_curve_storage storage) {
+  // The sampler is created last
+  if (storage == bt_curve_storage_texture && !state->curve_sampler &&
+      !bt_create_curve_textures(state)) {
+    return false;
+  }
+
+  SDL_WaitForGPUIdle(state->gpu);
+  bt_release_pipelines(state);
+  state->curve_storage = storage;
+  // None of the resident glyphs are in the other storage
+  bt_glyph_cache_deinit(&state->glyph_cache);
+  if (!bt_glyph_cache_init(&state->glyph_cache, &state->fonts,
+                           bt_glyph_cache_budget)) {
+    return false;
+  }
+
+  return bt_create_render_pipelines(state) &&
+         bt_create_compute_pipelines(state);
+}
+
+static bool bt_load_fonts(struct bt_state state[static 1],
+                          uint32_t font_path_count,
+                          char const *const font_paths[]) {
+  if (font_path_count > 0) {
+    return bt_font_stack_load(&state->fonts, font_path_count, font_paths);
+  }
+
+  char const *base_path = SDL_GetBasePath();
+  if (!base_path) {
+    BT_LOG_SDL_FAIL("Failed to get base path");
+    return false;
+  }
+  char *default_path = nullptr;
+  if (SDL_asprintf(&default_path, "%s%s", base_path, bt_default_font_pack) <
+      0) {
+    BT_LOG_SDL_FAIL("Failed to allocate font pack path");
+    return false;
+  }
+  bool result = bt_font_stack_load(&state->fonts, 1,
+                                   (char const *const[]){default_path});
+  SDL_free(default_path);
+
+  return result;
+}
+
+static char const *const bt_glyph_quality_names[] = {
+    [bt_glyph_quality_high] = "high",
+    [bt_glyph_quality_medium] = "medium",
+    [bt_glyph_quality_low] = "low",
+    [bt_glyph_quality_lowest] = "lowest",
+    [bt_glyph_quality_reference] = "reference",
+    [bt_glyph_quality_heatmap] = "heatmap",
+};
+
+static char const *const bt_text3d_mode_names[] = {
+    [bt_text3d_mode_discard] = "discard",
+    [bt_text3d_mode_msaa] = "msaa",
+};
+
+char const *const bt_text2d_mode_names[bt_text2d_mode_count] = {
+    [bt_text2d_mode_raster] = "raster",
+    [bt_text2d_mode_compute] = "compute",
+};
+
+char const *const bt_curve_storage_names[bt_curve_storage_count] = {
+    [bt_curve_storage_buffer] = "buffer",
+    [bt_curve_storage_texture] = "texture",
+};
+
+/*
+ * Index of the value of the environment variable in `names`, or `fallback` if
+ * it isn't set or isn't one of them
+ */
+static uint32_t bt_read_env_choice(char const *variable, uint32_t count,
+                                   char const *const names[static count],
+                                   uint32_t fallback) {
+  char const *name = SDL_getenv(variable);
+  if (!name) {
+    return fallback;
+  }
+  for (uint32_t i = 0; i < count; i += 1) {
+    if (SDL_strcmp(name, names[i]) == 0) {
+      return i;
+    }
+  }
+  BT_LOG_ERR("Unknown %s %s, using %s", variable, name, names[fallback]);
+  return fallback;
+}
+
+bool bt_state_init(struct bt_state state[static 1], uint32_t font_path_count,
+                   char const *const font_paths[]) {
   SDL_zerop(state);
+  state->glyph_quality = (enum bt_glyph_quality)bt_read_env_choice(
+      "BT_GLYPH_QUALITY", bt_glyph_quality_count, bt_glyph_quality_names,
+      bt_default_glyph_quality);
+  state->text2d_mode = (enum bt_text2d_mode)bt_read_env_choice(
+      "BT_TEXT2D_MODE", bt_text2d_mode_count, bt_text2d_mode_names,
+      bt_default_text2d_mode);
+  state->text3d_mode = (enum bt_text3d_mode)bt_read_env_choice(
+      "BT_TEXT3D_MODE", bt_text3d_mode_count, bt_text3d_mode_names,
+      bt_default_text3d_mode);
+  if (state->glyph_quality == bt_glyph_quality_heatmap) {
+    // The compute text2d mode and the multisampled targets of the msaa
+    // text3d mode don't count curves
+    state->text2d_mode = bt_text2d_mode_raster;
+    state->text3d_mode = bt_text3d_mode_discard;
+    state->heatmap_readback = SDL_getenv("BT_HEATMAP_READBACK") != nullptr;
+  }
+  state->curve_storage = (enum bt_curve_storage)bt_read_env_choice(
+      "BT_CURVE_STORAGE", bt_curve_storage_count, bt_curve_storage_names,
+      bt_default_curve_storage);
+  if (!bt_curve_storage_supported(state, state->curve_storage)) {
+    BT_LOG_ERR("No %s curve storage at the %s glyph quality, using %s",
+               bt_curve_storage_names[state->curve_storage],
+               bt_glyph_quality_names[state->glyph_quality],
+               bt_curve_storage_names[bt_curve_storage_buffer]);
+    state->curve_storage = bt_curve_storage_buffer;
+  }
 
+  if (!bt_load_fonts(state, font_path_count, font_paths)) {
+    return false;
+  }
+
+  if (!bt_glyph_cache_init(&state->glyph_cache, &state->fonts,
+                           bt_glyph_cache_budget)) {
+    return false;
+  }
+  bt_glyph_atlas_init(&state->glyph_atlas);
+
+  state->text_run_data =
+      SDL_calloc(bt_text_max_count, sizeof(*state->text_run_data));
   state->glyph2d_instance_data = SDL_calloc(
       bt_glyph2d_max_instances, sizeof(*state->glyph2d_instance_data));
   state->glyph3d_instance_data = SDL_calloc(
       bt_glyph3d_max_instances, sizeof(*state->glyph3d_instance_data));
-  if (!(state->glyph2d_instance_data && state->glyph3d_instance_data)) {
+  if (!(state->text_run_data && state->glyph2d_instance_data &&
+        state->glyph3d_instance_data)) {
     BT_LOG_SDL_FAIL("Failed to allocate instance data");
     return false;
   }
+  if (!(bt_slot_allocator_init(&state->text_slots[bt_text_kind_2d],
+                               bt_glyph2d_max_instances) &&
+        bt_slot_allocator_init(&state->text_slots[bt_text_kind_3d],
+                               bt_glyph3d_max_instances))) {
+    return false;
+  }
   state->width = 800;
   state->height = 800;
 
@@ -482,15 +1393,51 @@ bool bt_state_init(struct bt_state state[static 1]) {
   //                               SDL_GPU_SWAPCHAINCOMPOSITION_SDR,
   //                               SDL_GPU_PRESENTMODE_IMMEDIATE);
 
+  if (state->text3d_mode == bt_text3d_mode_msaa) {
+    SDL_GPUTextureFormat swapchain_format =
+        SDL_GetGPUSwapchainTextureFormat(state->gpu, state->window);
+    if (!SDL_GPUTextureSupportsSampleCount(state->gpu, swapchain_format,
+                                           bt_text3d_msaa_sample_count) ||
+        !SDL_GPUTextureSupportsSampleCount(state->gpu, bt_depth_format,
+                                           bt_text3d_msaa_sample_count)) {
+      BT_LOG_ERR("No multisampling for the msaa text3d mode, using %s",
+                 bt_text3d_mode_names[bt_text3d_mode_discard]);
+      state->text3d_mode = bt_text3d_mode_discard;
+    }
+  }
+
   state->depth_texture = bt_create_depth_texture(state);
   if (!state->depth_texture) {
     return false;
   }
+  if (state->text3d_mode == bt_text3d_mode_msaa) {
+    state->msaa_texture = bt_create_msaa_texture(state);
+    if (!state->msaa_texture) {
+      return false;
+    }
+  }
+  if (state->glyph_quality == bt_glyph_quality_heatmap &&
+      !bt_create_heatmap_targets(state)) {
+    return false;
+  }
+
+  if (!bt_create_text2d_targets(state)) {
+    return false;
+  }
+
+  if (!bt_create_glyph_atlas(state)) {
+    return false;
+  }
 
   if (!bt_create_buffers(state)) {
     return false;
   }
 
+  if (state->curve_storage == bt_curve_storage_texture &&
+      !bt_create_curve_textures(state)) {
+    return false;
+  }
+
   if (!bt_initialize_buffers(state)) {
     return false;
   }
@@ -503,10 +1450,37 @@ bool bt_state_init(struct bt_state state[static 1]) {
     return false;
   }
 
+  if (!bt_create_compute_pipelines(state)) {
+    return false;
+  }
+
+  char const *benchmark_frames = SDL_getenv("BT_TEXT2D_BENCHMARK");
+  if (benchmark_frames &&
+      !bt_state_benchmark_text2d(
+          state, (uint32_t)SDL_strtoul(benchmark_frames, nullptr, 10))) {
+    return false;
+  }
+  benchmark_frames = SDL_getenv("BT_CURVE_STORAGE_BENCHMARK");
+  if (benchmark_frames &&
+      !bt_state_benchmark_curve_storage(
+          state, (uint32_t)SDL_strtoul(benchmark_frames, nullptr, 10))) {
+    return false;
+  }
+
   if (!bt_game_run(&state->game)) {
     return false;
   }
 
+  // Filled in by the first FPS update
+  state->fps_text = bt_text_create(state, bt_text_kind_2d,
+                                   (float[3]){-1.0f, 1.0f, 0.0f}, 0.1f);
+  state->text3d = bt_text_create(state, bt_text_kind_3d,
+                                 (float[3]){0.0f, 0.0f, 0.0f}, 1.0f);
+  if (state->fps_text == bt_text_none || state->text3d == bt_text_none ||
+      !bt_text_set(state, state->text3d, "3D TEXT TEST:D")) {
+    return false;
+  }
+
   return true;
 }
 
@@ -514,11 +1488,7 @@ void bt_state_deinit(struct bt_state state[static 1]) {
   bt_game_stop(&state->game);
 
   SDL_WaitForGPUIdle(state->gpu);
-  for (enum bt_render_pipeline i = 0; i < bt_render_pipeline_count; i += 1) {
-    if (state->render_pipelines[i]) {
-      SDL_ReleaseGPUGraphicsPipeline(state->gpu, state->render_pipelines[i]);
-    }
-  }
+  bt_release_pipelines(state);
   for (enum bt_shader i = 0; i < bt_shader_count; i += 1) {
     if (state->shaders[i]) {
       SDL_ReleaseGPUShader(state->gpu, state->shaders[i]);
@@ -532,20 +1502,76 @@ void bt_state_deinit(struct bt_state state[static 1]) {
   if (state->depth_texture) {
     SDL_ReleaseGPUTexture(state->gpu, state->depth_texture);
   }
+  if (state->msaa_texture) {
+    SDL_ReleaseGPUTexture(state->gpu, state->msaa_texture);
+  }
+  if (state->heatmap_fence) {
+    SDL_ReleaseGPUFence(state->gpu, state->heatmap_fence);
+  }
+  if (state->heatmap_texture) {
+    SDL_ReleaseGPUTexture(state->gpu, state->heatmap_texture);
+  }
+  if (state->heatmap_transfer_buffer) {
+    SDL_ReleaseGPUTransferBuffer(state->gpu, state->heatmap_transfer_buffer);
+  }
+  if (state->text2d_texture) {
+    SDL_ReleaseGPUTexture(state->gpu, state->text2d_texture);
+  }
+  if (state->text2d_tile_buffer) {
+    SDL_ReleaseGPUBuffer(state->gpu, state->text2d_tile_buffer);
+  }
+  if (state->glyph_atlas_texture) {
+    SDL_ReleaseGPUTexture(state->gpu, state->glyph_atlas_texture);
+  }
+  if (state->glyph_atlas_sampler) {
+    SDL_ReleaseGPUSampler(state->gpu, state->glyph_atlas_sampler);
+  }
+  if (state->curve_texture) {
+    SDL_ReleaseGPUTexture(state->gpu, state->curve_texture);
+  }
+  if (state->curve_info_texture) {
+    SDL_ReleaseGPUTexture(state->gpu, state->curve_info_texture);
+  }
+  if (state->curve_sampler) {
+    SDL_ReleaseGPUSampler(state->gpu, state->curve_sampler);
+  }
   if (state->transfer_buffer) {
     SDL_ReleaseGPUTransferBuffer(state->gpu, state->transfer_buffer);
   }
+  for (uint32_t i = 0; i < bt_staging_frame_count; i += 1) {
+    if (state->staging_fences[i]) {
+      SDL_ReleaseGPUFence(state->gpu, state->staging_fences[i]);
+    }
+  }
+  if (state->staging_buffer) {
+    SDL_ReleaseGPUTransferBuffer(state->gpu, state->staging_buffer);
+  }
+  if (state->staging_data) {
+    SDL_free(state->staging_data);
+  }
+  if (state->glyph_cache_transfer_buffer) {
+    SDL_ReleaseGPUTransferBuffer(state->gpu,
+                                 state->glyph_cache_transfer_buffer);
+  }
   if (state->gpu) {
     SDL_DestroyGPUDevice(state->gpu);
   }
   if (state->window) {
     SDL_DestroyWindow(state->window);
   }
+  if (state->text_run_data) {
+    SDL_free(state->text_run_data);
+  }
   if (state->glyph2d_instance_data) {
     SDL_free(state->glyph2d_instance_data);
   }
   if (state->glyph3d_instance_data) {
     SDL_free(state->glyph3d_instance_data);
   }
+  for (enum bt_text_kind i = 0; i < bt_text_kind_count; i += 1) {
+    bt_slot_allocator_deinit(&state->text_slots[i]);
+  }
+  bt_glyph_cache_deinit(&state->glyph_cache);
+  bt_font_stack_unload(&state->fonts);
   SDL_memset(state, 0, sizeof(*state));
 }
@@ -4,29 +4,183 @@
 #include "state.h"
 #include <SDL3/SDL_gpu.h>
 
-constexpr size_t bt_glyph2d_max_instances = 512;
+/*
+ * Slots in the instance buffers, shared by the texts of each kind
+ */
+constexpr size_t bt_glyph2d_max_instances = 4096;
 constexpr size_t bt_glyph3d_max_instances = 256;
 
-constexpr SDL_GPUIndexedIndirectDrawCommand bt_draw_data_array[] = {
-    {
-        .num_indices = 6,
-        .num_instances = bt_glyph2d_max_instances,
-        .first_index = 0,
-        .vertex_offset = 0,
-        .first_instance = 0,
-    },
+/*
+ * The draw commands in the draw buffer
+ */
+enum bt_draw {
+  bt_draw_glyph2d = 0,
+  bt_draw_glyph3d,
+
+  bt_draw_count,
+};
+
+/*
+ * Nothing is drawn until the text is first set. The instance counts are
+ * replaced with the live ones whenever the text changes, see
+ * bt_state_update_draw_data in state_gfx.c.
+ */
+constexpr SDL_GPUIndexedIndirectDrawCommand bt_draw_data_array[bt_draw_count] =
     {
-        .num_indices = 6,
-        .num_instances = bt_glyph3d_max_instances,
-        .first_index = 0,
-        .vertex_offset = 0,
-        .first_instance = 0,
-    },
+        [bt_draw_glyph2d] =
+            {
+                .num_indices = 6,
+                .num_instances = 0,
+                .first_index = 0,
+                .vertex_offset = 0,
+                .first_instance = 0,
+            },
+        [bt_draw_glyph3d] =
+            {
+                .num_indices = 6,
+                .num_instances = 0,
+                .first_index = 0,
+                .vertex_offset = 0,
+                .first_instance = 0,
+            },
 };
 
+constexpr float bt_fov_y = bt_pi * 0.25f;
+constexpr float bt_near_plane = 0.1f;
+
+constexpr char bt_default_font_pack[] = "default.btf";
+/*
+ * Bytes of GPU memory for the curves of resident glyphs, see glyph_cache.h
+ */
+constexpr uint32_t bt_glyph_cache_budget = 1u << 20;
+
+/*
+ * Used when BT_GLYPH_QUALITY isn't set, see bt_state_init
+ */
+constexpr enum bt_glyph_quality bt_default_glyph_quality =
+    bt_glyph_quality_high;
+/*
+ * Used when BT_TEXT2D_MODE isn't set, see bt_state_init
+ */
+constexpr enum bt_text2d_mode bt_default_text2d_mode = bt_text2d_mode_raster;
+extern char const *const bt_text2d_mode_names[bt_text2d_mode_count];
+/*
+ * Used when BT_TEXT3D_MODE isn't set, see bt_state_init
+ */
+constexpr enum bt_text3d_mode bt_default_text3d_mode = bt_text3d_mode_discard;
+/*
+ * Used when BT_CURVE_STORAGE isn't set, see bt_state_init
+ */
+constexpr enum bt_curve_storage bt_default_curve_storage =
+    bt_curve_storage_buffer;
+extern char const *const bt_curve_storage_names[bt_curve_storage_count];
+/*
+ * Samples per pixel of the msaa text3d mode, which are also the levels of
+ * alpha it can show
+ */
+constexpr SDL_GPUSampleCount bt_text3d_msaa_sample_count =
+    SDL_GPU_SAMPLECOUNT_4;
+
+/*
+ * The compute text2d mode bins the glyphs into square tiles this many pixels
+ * wide. Each tile lists up to bt_text2d_tile_max_glyphs glyphs after their
+ * count, the rest are dropped. See text2d_tiles.glsli.
+ */
+constexpr uint32_t bt_text2d_tile_size = 16;
+constexpr uint32_t bt_text2d_tile_max_glyphs = 63;
+constexpr uint32_t bt_text2d_tile_stride = bt_text2d_tile_max_glyphs + 1;
+/*
+ * Glyphs binned per workgroup, see text2d_bin.comp.glsl
+ */
+constexpr uint32_t bt_text2d_bin_group_size = 64;
+
 constexpr SDL_GPUTextureFormat bt_depth_format =
     SDL_GPU_TEXTUREFORMAT_D16_UNORM;
+constexpr SDL_GPUTextureFormat bt_glyph_atlas_format =
+    SDL_GPU_TEXTUREFORMAT_R8_UNORM;
+constexpr SDL_GPUTextureFormat bt_text2d_format =
+    SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+/*
+ * Curves tested and accepted per pixel, added up by blending, see the heatmap
+ * glyph quality
+ */
+constexpr SDL_GPUTextureFormat bt_heatmap_format =
+    SDL_GPU_TEXTUREFORMAT_R32G32_FLOAT;
+
+/*
+ * Texels per row of the textures of the texture curve storage, see
+ * glyph_coverage.glsli. The curves are packed into the curve texture as they
+ * are in the curve buffer, and each of its rows holds whole glyph cache pages,
+ * so that the pages of a glyph can be uploaded a row at a time. A curve
+ * texel holds two of the 16 bit grid positions of the control points.
+ */
+constexpr uint32_t bt_curve_texture_width = 1536;
+constexpr uint32_t bt_curve_info_texture_width = 1024;
+constexpr uint32_t bt_curve_texture_texel_size = (uint32_t)sizeof(uint16_t[4]);
+constexpr uint32_t bt_curve_texture_page_texels =
+    bt_glyph_cache_page_size / bt_curve_texture_texel_size;
+constexpr SDL_GPUTextureFormat bt_curve_texture_format =
+    SDL_GPU_TEXTUREFORMAT_R16G16B16A16_UINT;
+constexpr SDL_GPUTextureFormat bt_curve_info_texture_format =
+    SDL_GPU_TEXTUREFORMAT_R32G32B32A32_UINT;
 
+/*
+ * The depth texture is multisampled in the msaa text3d mode, which also
+ * renders into a multisampled texture that's resolved into the swapchain
+ */
 SDL_GPUTexture *bt_create_depth_texture(struct bt_state state[static 1]);
+SDL_GPUTexture *bt_create_msaa_texture(struct bt_state state[static 1]);
+/*
+ * (Re)creates the window sized texture and tile buffer of the compute text2d
+ * mode, waiting for the GPU to finish with the old ones
+ */
+bool bt_create_text2d_targets(struct bt_state state[static 1]);
+/*
+ * (Re)creates the window sized texture the heatmap glyph quality counts curves
+ * in, and the transfer buffer it's read back through, waiting for the GPU to
+ * finish with the old ones
+ */
+bool bt_create_heatmap_targets(struct bt_state state[static 1]);
+/*
+ * Switches to the curve storage, recreating the pipelines for it. The glyph
+ * cache starts over empty, so the glyphs have to be touched again before they
+ * are drawn.
+ */
+bool bt_set_curve_storage(struct bt_state state[static 1],
+                          enum bt_curve_storage storage);
+/*
+ * Whether the shaders of the glyph quality have variants for the curve
+ * storage
+ */
+bool bt_curve_storage_supported(struct bt_state const state[static 1],
+                                enum bt_curve_storage storage);
+
+// state_gfx.c
+/*
+ * Writes `data` at `offset` in one of the buffers that go through the staging
+ * ring, for the next frame to upload. Only the bytes that differ from what the
+ * buffer already holds are marked dirty, so rewriting data that didn't change
+ * uploads nothing.
+ */
+void bt_state_write_buffer(struct bt_state state[static 1],
+                           enum bt_gpu_buffer buffer, uint32_t offset,
+                           size_t data_size, void const *data);
+/*
+ * Writes the instance counts into the draw commands
+ */
+void bt_state_update_draw_data(struct bt_state state[static 1]);
+
+// state_text.c
+/*
+ * Packs a glyph from bt_font_stack_glyph and its cell from
+ * bt_glyph_atlas_touch into the `glyph` words of an instance
+ */
+void bt_glyph_instance_ids(uint32_t glyph, uint32_t atlas,
+                           uint16_t out[static 2]);
+/*
+ * Packs the index of a run and the advance of a glyph from the start of it,
+ * in glyph quad units, into the `run_advance` of an instance
+ */
+uint32_t bt_glyph_instance_run_advance(uint32_t run, float advance);
 
 #endif
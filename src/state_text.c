@@ -0,0 +1,558 @@
+#include "logging.h"
+#include "state_private.h"
+#include <uchar.h>
+
+/*
+ * Texts get their slots in multiples of this, so that a text that grows by a
+ * few characters, like the FPS counter, usually stays where it is
+ */
+constexpr uint32_t bt_text_slot_granularity = 8;
+
+constexpr enum bt_gpu_buffer bt_text_buffers[bt_text_kind_count] = {
+    [bt_text_kind_2d] = bt_gpu_buffer_glyph2d_instance,
+    [bt_text_kind_3d] = bt_gpu_buffer_glyph3d_instance,
+};
+
+constexpr uint32_t bt_text_max_lengths[bt_text_kind_count] = {
+    [bt_text_kind_2d] = bt_glyph2d_max_instances,
+    [bt_text_kind_3d] = bt_glyph3d_max_instances,
+};
+
+static char const *const bt_text_kind_names[bt_text_kind_count] = {
+    [bt_text_kind_2d] = "2D",
+    [bt_text_kind_3d] = "3D",
+};
+
+/*
+ * Returns whether the glyph has an outline or a shadow
+ */
+static bool
+bt_glyph_effects_enabled(struct bt_glyph_effects const effects[static 1]) {
+  return (bt_half_to_float(effects->outline_width) > 0.0f &&
+          effects->outline_color[3] > 0) ||
+         effects->shadow_color[3] > 0;
+}
+
+/*
+ * Returns the atlas cell of a glyph whose quad is drawn `pixels` wide, or
+ * bt_glyph_atlas_none if it's drawn from its curves
+ */
+static uint32_t
+bt_state_touch_glyph_atlas(struct bt_state state[static 1], uint32_t glyph,
+                           struct bt_font_metrics const metrics[static 1],
+                           float pixels) {
+  // The reference shaders are there to check the curves
+  if (state->glyph_quality == bt_glyph_quality_reference ||
+      !bt_glyph_atlas_fits(metrics->bounds)) {
+    return bt_glyph_atlas_none;
+  }
+  uint32_t size = bt_glyph_atlas_size(pixels);
+  if (size == bt_glyph_atlas_none) {
+    return bt_glyph_atlas_none;
+  }
+  return bt_glyph_atlas_touch(&state->glyph_atlas, glyph, size);
+}
+
+/*
+ * The 2D text is drawn over the 3D text, and the outline and shadow keep it
+ * readable there
+ */
+static struct bt_glyph_effects bt_glyph2d_effects(void) {
+  uint16_t shadow_offset = bt_half_from_float(1.0f / 16.0f);
+  return (struct bt_glyph_effects){
+      .outline_width = bt_half_from_float(1.0f / 32.0f),
+      .shadow_offset = {shadow_offset, shadow_offset},
+      .outline_color = {0, 0, 0, 255},
+      .shadow_color = {0, 0, 0, 128},
+  };
+}
+
+void bt_glyph_instance_ids(uint32_t glyph, uint32_t atlas,
+                           uint16_t out[static 2]) {
+  uint32_t cell = bt_glyph_instance_atlas_none;
+  if (atlas != bt_glyph_atlas_none) {
+    cell = (atlas >> bt_glyph_atlas_size_shift)
+               << bt_glyph_instance_size_shift |
+           (atlas & bt_glyph_atlas_cell_mask);
+  }
+  uint32_t font = glyph >> bt_font_stack_glyph_bits;
+  out[0] = (uint16_t)(glyph & bt_font_stack_glyph_mask);
+  out[1] = (uint16_t)(font << bt_glyph_instance_font_shift | cell);
+}
+
+uint32_t bt_glyph_instance_run_advance(uint32_t run, float advance) {
+  // Rounded to the nearest step, and texts that run out of steps pile up at
+  // the last one
+  float steps = SDL_min(advance / bt_glyph_instance_advance_step + 0.5f,
+                        (float)bt_glyph_instance_advance_mask);
+  return run << bt_glyph_instance_run_shift | (uint32_t)steps;
+}
+
+/*
+ * The advance of an instance from bt_glyph_instance_run_advance, in glyph quad
+ * units
+ */
+static float bt_glyph_instance_advance(uint32_t run_advance) {
+  return (float)(run_advance & bt_glyph_instance_advance_mask) *
+         bt_glyph_instance_advance_step;
+}
+
+/*
+ * The packed glyph of the `glyph` words of an instance
+ */
+static uint32_t bt_glyph_instance_glyph(uint16_t const ids[static 2]) {
+  uint32_t font = (uint32_t)ids[1] >> bt_glyph_instance_font_shift;
+  return font << bt_font_stack_glyph_bits | ids[0];
+}
+
+static struct bt_glyph_instance_data *
+bt_text_instances(struct bt_state state[static 1], enum bt_text_kind kind) {
+  return kind == bt_text_kind_2d ? state->glyph2d_instance_data
+                                 : state->glyph3d_instance_data;
+}
+
+/*
+ * The index of the text, which is also the index of its run
+ */
+static uint32_t bt_text_index(struct bt_state const state[static 1],
+                              struct bt_text const text[static 1]) {
+  return (uint32_t)(text - state->texts);
+}
+
+/*
+ * Writes the run of the text from its position and scale, for the next frame
+ * to upload
+ */
+static void bt_text_write_run(struct bt_state state[static 1],
+                              uint32_t text_index) {
+  struct bt_text const *text = &state->texts[text_index];
+  struct bt_text_run_data *run = &state->text_run_data[text_index];
+  switch (text->kind) {
+  case bt_text_kind_2d:
+    // The position is the top left corner of the first glyph quad, and the
+    // shaders add the x half of the quad, which depends on the window size
+    *run = (struct bt_text_run_data){
+        .translation = {text->position[0],
+                        text->position[1] - 0.5f * text->scale},
+        .scale = text->scale,
+        .effects = bt_glyph2d_effects(),
+    };
+    break;
+  case bt_text_kind_3d:
+    // Facing the +z axis
+    *run = (struct bt_text_run_data){
+        .translation = {text->position[0], text->position[1],
+                        text->position[2]},
+        .scale = text->scale,
+        .rotation = {0.0f, 0.0f, 0.0f, 1.0f},
+    };
+    break;
+  default:
+    break;
+  }
+  bt_state_write_buffer(state, bt_gpu_buffer_text_run,
+                        (uint32_t)(text_index * sizeof(*run)), sizeof(*run),
+                        run);
+}
+
+/*
+ * Writes the instances in the slots [first, first + count) to the instance
+ * buffer of the kind
+ */
+static void bt_text_write_slots(struct bt_state state[static 1],
+                                enum bt_text_kind kind, uint32_t first,
+                                uint32_t count) {
+  constexpr size_t size = sizeof(struct bt_glyph_instance_data);
+  bt_state_write_buffer(state, bt_text_buffers[kind], (uint32_t)(first * size),
+                        count * size, &bt_text_instances(state, kind)[first]);
+}
+
+/*
+ * Zeroes the instances in the slots, which makes them the empty glyph 0 so
+ * that they cover no pixels while they're still below the draw count
+ */
+static void bt_text_clear_slots(struct bt_state state[static 1],
+                                enum bt_text_kind kind, uint32_t first,
+                                uint32_t count) {
+  SDL_memset(&bt_text_instances(state, kind)[first], 0,
+             count * sizeof(struct bt_glyph_instance_data));
+  bt_text_write_slots(state, kind, first, count);
+}
+
+/*
+ * Draws the instances up to the last slot used by a text of each kind
+ */
+static void bt_text_update_draw_data(struct bt_state state[static 1]) {
+  state->glyph2d_instance_count =
+      bt_slot_allocator_end(&state->text_slots[bt_text_kind_2d]);
+  state->glyph3d_instance_count =
+      bt_slot_allocator_end(&state->text_slots[bt_text_kind_3d]);
+  bt_state_update_draw_data(state);
+}
+
+struct bt_text_order {
+  uint32_t first;
+  uint32_t text;
+};
+
+static int bt_compare_text_orders(void const *a, void const *b) {
+  uint32_t lhs = ((struct bt_text_order const *)a)->first;
+  uint32_t rhs = ((struct bt_text_order const *)b)->first;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/*
+ * Moves the slots of every text of the kind down to the start of its instance
+ * buffer, keeping their order, and clears the slots they leave behind
+ */
+static void bt_text_compact(struct bt_state state[static 1],
+                            enum bt_text_kind kind) {
+  struct bt_slot_allocator *slots = &state->text_slots[kind];
+  uint32_t end = bt_slot_allocator_end(slots);
+
+  struct bt_text_order orders[bt_text_max_count];
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < bt_text_max_count; i += 1) {
+    struct bt_text const *text = &state->texts[i];
+    if (text->used && text->kind == kind && text->capacity > 0) {
+      orders[count] = (struct bt_text_order){
+          .first = text->first,
+          .text = i,
+      };
+      count += 1;
+    }
+  }
+  SDL_qsort(orders, count, sizeof(*orders), bt_compare_text_orders);
+
+  struct bt_glyph_instance_data *instances = bt_text_instances(state, kind);
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < count; i += 1) {
+    struct bt_text *text = &state->texts[orders[i].text];
+    if (text->first != next) {
+      SDL_memmove(&instances[next], &instances[text->first],
+                  text->capacity * sizeof(*instances));
+      text->first = next;
+    }
+    next += text->capacity;
+  }
+  SDL_memset(&instances[next], 0, (end - next) * sizeof(*instances));
+  bt_text_write_slots(state, kind, 0, end);
+  bt_slot_allocator_reset(slots, next);
+}
+
+/*
+ * Clears and frees the slots of the text, and compacts the texts of its kind
+ * if that leaves too many holes in front of the draw count
+ */
+static void bt_text_free_slots(struct bt_state state[static 1],
+                               struct bt_text text[static 1]) {
+  if (text->capacity == 0) {
+    return;
+  }
+  struct bt_slot_allocator *slots = &state->text_slots[text->kind];
+  bt_text_clear_slots(state, text->kind, text->first, text->capacity);
+  bt_slot_allocator_free(slots, text->first, text->capacity);
+  text->first = bt_slot_none;
+  text->capacity = 0;
+  text->length = 0;
+  if (bt_slot_allocator_fragmented(slots)) {
+    bt_text_compact(state, text->kind);
+  }
+}
+
+/*
+ * Moves the text to `capacity` new slots, compacting the texts of its kind if
+ * there's no run that long. Logs and returns false if there isn't room for it
+ * even then, in which case the text has no slots.
+ */
+static bool bt_text_reserve(struct bt_state state[static 1],
+                            struct bt_text text[static 1], uint32_t capacity) {
+  struct bt_slot_allocator *slots = &state->text_slots[text->kind];
+  bt_text_free_slots(state, text);
+
+  uint32_t first = bt_slot_allocator_alloc(slots, capacity);
+  if (first == bt_slot_none && slots->free_count >= capacity) {
+    bt_text_compact(state, text->kind);
+    first = bt_slot_allocator_alloc(slots, capacity);
+  }
+  if (first == bt_slot_none) {
+    BT_LOG_ERR("No room for %u more %s glyphs", capacity,
+               bt_text_kind_names[text->kind]);
+    return false;
+  }
+  text->first = first;
+  text->capacity = capacity;
+  return true;
+}
+
+/*
+ * Decodes `string` up to its 0 or `max_length` characters, whichever comes
+ * first, and returns the number of characters
+ */
+static uint32_t bt_text_decode(char const *string, uint32_t max_length,
+                               uint32_t chars[static max_length]) {
+  size_t remaining = SDL_strlen(string);
+  mbstate_t mbstate = {};
+  uint32_t length = 0;
+  while (length < max_length) {
+    char32_t c = 0;
+    size_t n = mbrtoc32(&c, string, remaining, &mbstate);
+    if (n == 0 || n == (size_t)-1 || n == (size_t)-2) {
+      break;
+    }
+    string += n;
+    remaining -= n;
+    chars[length] = c;
+    length += 1;
+  }
+  return length;
+}
+
+/*
+ * Fills the text's instances for `chars`, left to right from the start of its
+ * run
+ */
+static void bt_text_layout(struct bt_state state[static 1],
+                           struct bt_text const text[static 1],
+                           uint32_t const chars[static text->length]) {
+  struct bt_glyph_instance_data *instances =
+      &bt_text_instances(state, text->kind)[text->first];
+  uint32_t run = bt_text_index(state, text);
+  float advance = 0.0f;
+  for (uint32_t i = 0; i < text->length; i += 1) {
+    uint32_t glyph = bt_font_stack_glyph(&state->fonts, chars[i]);
+    instances[i] = (struct bt_glyph_instance_data){
+        .run_advance = bt_glyph_instance_run_advance(run, advance),
+    };
+    bt_glyph_instance_ids(glyph, bt_glyph_atlas_none, instances[i].glyph);
+    advance += bt_font_stack_metrics(&state->fonts, glyph)->advance;
+  }
+}
+
+/*
+ * Touches the glyphs of a 2D text in the glyph cache and picks their atlas
+ * cells
+ */
+static void bt_text_touch_2d(struct bt_state state[static 1],
+                             struct bt_text const text[static 1]) {
+  // The compute text2d mode and the effects always draw from the curves
+  bool curves =
+      state->text2d_mode == bt_text2d_mode_compute ||
+      bt_glyph_effects_enabled(
+          &state->text_run_data[bt_text_index(state, text)].effects);
+  for (uint32_t i = 0; i < text->length; i += 1) {
+    struct bt_glyph_instance_data *instance_data =
+        &state->glyph2d_instance_data[text->first + i];
+    uint32_t glyph = bt_glyph_instance_glyph(instance_data->glyph);
+    struct bt_font_metrics const *metrics =
+        bt_font_stack_metrics(&state->fonts, glyph);
+    bt_glyph_cache_touch(&state->glyph_cache, glyph);
+    // The quad is `scale` high in normalized device coordinates, which span
+    // the window height twice
+    uint32_t atlas =
+        curves ? bt_glyph_atlas_none
+               : bt_state_touch_glyph_atlas(state, glyph, metrics,
+                                            text->scale * 0.5f *
+                                                (float)state->height);
+    bt_glyph_instance_ids(glyph, atlas, instance_data->glyph);
+  }
+}
+
+struct bt_glyph3d_depth {
+  float distance;
+  uint32_t index;
+};
+
+static int bt_compare_glyph3d_depths(void const *a, void const *b) {
+  float lhs = ((struct bt_glyph3d_depth const *)a)->distance;
+  float rhs = ((struct bt_glyph3d_depth const *)b)->distance;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/*
+ * Orders the glyphs of a 3D text by their distance from the camera. Front to
+ * back in the msaa text3d mode, so that the depth test rejects the pixels of
+ * glyphs behind nearer ones before they're shaded, and back to front
+ * otherwise, which is the order blending their edges needs. Texts are drawn in
+ * the order of their slots, so only the glyphs within a text are sorted.
+ */
+static void
+bt_text_sort_3d(struct bt_state state[static 1],
+                struct bt_text const text[static 1],
+                float const distances[static bt_glyph3d_max_instances]) {
+  float sign = state->text3d_mode == bt_text3d_mode_msaa ? 1.0f : -1.0f;
+  struct bt_glyph3d_depth depths[bt_glyph3d_max_instances];
+  for (uint32_t i = 0; i < text->length; i += 1) {
+    depths[i] = (struct bt_glyph3d_depth){
+        .distance = sign * distances[i],
+        .index = text->first + i,
+    };
+  }
+  SDL_qsort(depths, text->length, sizeof(*depths), bt_compare_glyph3d_depths);
+
+  struct bt_glyph_instance_data sorted[bt_glyph3d_max_instances];
+  for (uint32_t i = 0; i < text->length; i += 1) {
+    sorted[i] = state->glyph3d_instance_data[depths[i].index];
+  }
+  SDL_memcpy(&state->glyph3d_instance_data[text->first], sorted,
+             text->length * sizeof(*sorted));
+}
+
+/*
+ * Touches the levels of detail of the glyphs of a 3D text in the glyph cache,
+ * picks their atlas cells and sorts them
+ */
+static void bt_text_touch_3d(struct bt_state state[static 1],
+                             struct bt_text const text[static 1]) {
+  struct bt_render_info info = {};
+  bt_game_get_render_info(&state->game, &info);
+  // Pixels per world unit at a distance of 1 from the camera
+  float pixels_per_unit =
+      0.5f * (float)state->height / SDL_tanf(0.5f * bt_fov_y);
+
+  struct bt_text_run_data const *run =
+      &state->text_run_data[bt_text_index(state, text)];
+  float distances[bt_glyph3d_max_instances];
+  for (uint32_t i = 0; i < text->length; i += 1) {
+    struct bt_glyph_instance_data *instance_data =
+        &state->glyph3d_instance_data[text->first + i];
+    uint32_t glyph = bt_glyph_instance_glyph(instance_data->glyph);
+    struct bt_font_metrics const *metrics =
+        bt_font_stack_metrics(&state->fonts, glyph);
+    // The vertex shader picks the level of detail to draw
+    for (uint32_t level = 0; level < bt_font_lod_count; level += 1) {
+      uint32_t lod = bt_font_stack_glyph_lod(&state->fonts, glyph, level);
+      bt_glyph_cache_touch(&state->glyph_cache, lod);
+    }
+    // Picked for where the camera is now, the fragment shader falls back to
+    // the curves if it gets much closer or further away before the next
+    // update. The 3D texts aren't rotated, so their glyphs are along the x
+    // axis from the start of the run.
+    float distance = bt_vec3_length(bt_vec3_add(
+        (struct bt_vec3){
+            .x = run->translation[0] +
+                 bt_glyph_instance_advance(instance_data->run_advance) *
+                     run->scale,
+            .y = run->translation[1],
+            .z = run->translation[2],
+        },
+        bt_vec3_negate(info.current_state.camera_pos)));
+    uint32_t atlas =
+        distance > bt_near_plane
+            ? bt_state_touch_glyph_atlas(state, glyph, metrics,
+                                         text->scale * pixels_per_unit /
+                                             distance)
+            : bt_glyph_atlas_none;
+    bt_glyph_instance_ids(glyph, atlas, instance_data->glyph);
+    distances[i] = distance;
+  }
+  // Sorted for where the camera is now, like the atlas sizes
+  bt_text_sort_3d(state, text, distances);
+}
+
+static void bt_text_touch(struct bt_state state[static 1],
+                          struct bt_text const text[static 1]) {
+  switch (text->kind) {
+  case bt_text_kind_2d:
+    bt_text_touch_2d(state, text);
+    break;
+  case bt_text_kind_3d:
+    bt_text_touch_3d(state, text);
+    break;
+  default:
+    break;
+  }
+}
+
+uint32_t bt_text_create(struct bt_state state[static 1],
+                        enum bt_text_kind kind,
+                        float const position[static 3], float scale) {
+  for (uint32_t i = 0; i < bt_text_max_count; i += 1) {
+    struct bt_text *text = &state->texts[i];
+    if (text->used) {
+      continue;
+    }
+    *text = (struct bt_text){
+        .kind = kind,
+        .position = {position[0], position[1], position[2]},
+        .scale = scale,
+        .first = bt_slot_none,
+        .used = true,
+    };
+    bt_text_write_run(state, i);
+    return i;
+  }
+  BT_LOG_ERR("Can't create more than %u texts", bt_text_max_count);
+  return bt_text_none;
+}
+
+/*
+ * Whether the text was created and not destroyed since. bt_text_none isn't.
+ */
+static bool bt_text_valid(struct bt_state const state[static 1],
+                          uint32_t text_index) {
+  return text_index < bt_text_max_count && state->texts[text_index].used;
+}
+
+bool bt_text_set(struct bt_state state[static 1], uint32_t text_index,
+                 char const *string) {
+  if (!bt_text_valid(state, text_index)) {
+    return false;
+  }
+  struct bt_text *text = &state->texts[text_index];
+  uint32_t chars[bt_glyph2d_max_instances];
+  uint32_t length =
+      bt_text_decode(string, bt_text_max_lengths[text->kind], chars);
+
+  uint32_t capacity = (length + bt_text_slot_granularity - 1) /
+                      bt_text_slot_granularity * bt_text_slot_granularity;
+  if (capacity > text->capacity && !bt_text_reserve(state, text, capacity)) {
+    bt_text_update_draw_data(state);
+    return false;
+  }
+  text->length = length;
+  bt_text_layout(state, text, chars);
+  bt_text_touch(state, text);
+
+  if (text->capacity > 0) {
+    // The slots the text no longer fills, in case it got shorter
+    struct bt_glyph_instance_data *instances =
+        bt_text_instances(state, text->kind);
+    SDL_memset(&instances[text->first + length], 0,
+               (text->capacity - length) * sizeof(*instances));
+    bt_text_write_slots(state, text->kind, text->first, text->capacity);
+  }
+  bt_text_update_draw_data(state);
+  return true;
+}
+
+void bt_text_move(struct bt_state state[static 1], uint32_t text_index,
+                  float const position[static 3]) {
+  if (!bt_text_valid(state, text_index)) {
+    return;
+  }
+  struct bt_text *text = &state->texts[text_index];
+  SDL_memcpy(text->position, position, sizeof(text->position));
+  bt_text_write_run(state, text_index);
+}
+
+void bt_text_destroy(struct bt_state state[static 1], uint32_t text_index) {
+  if (!bt_text_valid(state, text_index)) {
+    return;
+  }
+  struct bt_text *text = &state->texts[text_index];
+  bt_text_free_slots(state, text);
+  *text = (struct bt_text){};
+  bt_text_update_draw_data(state);
+}
+
+void bt_state_touch_texts(struct bt_state state[static 1]) {
+  for (uint32_t i = 0; i < bt_text_max_count; i += 1) {
+    struct bt_text const *text = &state->texts[i];
+    if (!text->used || text->length == 0) {
+      continue;
+    }
+    bt_text_touch(state, text);
+    bt_text_write_slots(state, text->kind, text->first, text->length);
+  }
+}
@@ -0,0 +1,58 @@
+#version 460
+
+// First pass of the compute text2d mode: adds each glyph to the list of every
+// screen tile its quad touches, for text2d_tiles.comp.glsl
+#extension GL_GOOGLE_include_directive : require
+
+layout(local_size_x = 64) in;
+
+// Grid of the glyph bounds, see data.h
+const float bt_font_curve_min = -0.5;
+const float bt_font_curve_step = 2.0 / 65536.0;
+
+#define BT_INSTANCE_BINDING 0
+#define BT_TILE_BINDING 0
+#define BT_RUN_SET 0
+#define BT_RUN_BINDING 1
+#define BT_FONT_OFFSETS_BINDING 3
+#include "text2d_tiles.glsli"
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= u_instance_count) {
+        return;
+    }
+
+    bt_glyph2d instance = load_glyph2d(index);
+    vec2 bounds_min;
+    vec2 bounds_max;
+    mat3 model = glyph2d_model(instance);
+    // Unused instances are the empty glyph, and glyphs of runs scaled to
+    // nothing would all pile up in one tile otherwise
+    if (!glyph2d_bounds(instance, bounds_min, bounds_max) || determinant(mat2(model[0].xy, model[1].xy)) == 0.0) {
+        return;
+    }
+
+    // Pixel bounds of the quad, which may be rotated
+    vec2 pixel_min = vec2(1.0e30);
+    vec2 pixel_max = vec2(-1.0e30);
+    for (uint i = 0; i < 4; i += 1) {
+        vec2 uv = mix(bounds_min, bounds_max, vec2(i & 1, i >> 1));
+        vec2 ndc = (model * vec3(uv.x - 0.5, 0.5 - uv.y, 1.0)).xy;
+        vec2 pixel = vec2(ndc.x + 1.0, 1.0 - ndc.y) * 0.5 * vec2(u_size);
+        pixel_min = min(pixel_min, pixel);
+        pixel_max = max(pixel_max, pixel);
+    }
+    ivec2 tile_min = max(ivec2(floor(pixel_min / float(bt_text2d_tile_size))), ivec2(0));
+    ivec2 tile_max = min(ivec2(floor(pixel_max / float(bt_text2d_tile_size))), ivec2(u_tile_count) - 1);
+
+    for (int y = tile_min.y; y <= tile_max.y; y += 1) {
+        for (int x = tile_min.x; x <= tile_max.x; x += 1) {
+            uint tile = (uint(y) * u_tile_count.x + uint(x)) * bt_text2d_tile_stride;
+            uint slot = atomicAdd(tiles[tile], 1u);
+            if (slot < bt_text2d_tile_max_glyphs) {
+                tiles[tile + 1 + slot] = index;
+            }
+        }
+    }
+}
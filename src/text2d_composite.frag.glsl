@@ -0,0 +1,11 @@
+#version 460
+
+// Draws the 2D text of the compute text2d mode over the 3D scene, blended like
+// the glyph quads, see text2d_tiles.comp.glsl
+layout(set = 2, binding = 0) uniform sampler2D text2d;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = texelFetch(text2d, ivec2(gl_FragCoord.xy), 0);
+}
@@ -0,0 +1,7 @@
+#version 460
+
+// One triangle over the whole window, see text2d_composite.frag.glsl
+void main() {
+    vec2 pos = vec2((gl_VertexIndex & 1) * 4 - 1, 1 - (gl_VertexIndex >> 1) * 4);
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
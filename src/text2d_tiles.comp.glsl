@@ -0,0 +1,120 @@
+#version 460
+
+// Second pass of the compute text2d mode: one workgroup per screen tile,
+// which blends only the glyphs text2d_bin.comp.glsl binned into the tile and
+// writes the result for text2d_composite.frag.glsl
+#extension GL_GOOGLE_include_directive : require
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// Like the 2D pipeline at the high glyph quality, see glyph.frag.glsl. Also
+// built with BT_CURVE_TEXTURE, which puts the curves and curve infos in the
+// first two sampler bindings instead of the first two storage buffers.
+#define BT_DUAL_AXIS
+#define BT_FONT_SET 0
+#define BT_FONT_BINDING 0
+#include "glyph_coverage.glsli"
+
+#define BT_INSTANCE_BINDING 4
+#define BT_TILE_BINDING 1
+#define BT_RUN_SET 0
+#define BT_RUN_BINDING 6
+#include "text2d_tiles.glsli"
+
+// bt_vertex_data in state_init.c, the colors of the quad corners
+struct bt_vertex {
+    float color[3];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer bt_vertices {
+    bt_vertex vertices[];
+};
+
+// Straight alpha, like the glyph quads output before blending
+layout(set = 1, binding = 0, rgba8) uniform writeonly image2D text2d;
+
+// The packed glyph, without the atlas cell the compute mode doesn't use
+uint glyph2d_glyph(bt_glyph2d instance) {
+    return (instance.glyph >> (16 + bt_glyph_instance_font_shift)) << bt_font_stack_glyph_bits | (instance.glyph & 0xFFFFu);
+}
+
+shared uint tile_glyphs[bt_text2d_tile_max_glyphs];
+shared uint tile_glyph_count;
+
+vec3 vertex_color(uint i) {
+    return vec3(vertices[i].color[0], vertices[i].color[1], vertices[i].color[2]);
+}
+
+// The color the rasterizer interpolates at s, the position in the quad, for
+// the triangles of bt_index_data_array in state_init.c
+vec3 quad_color(vec2 s) {
+    if (s.x + s.y <= 1.0) {
+        return vertex_color(0) * (1.0 - s.x - s.y) + vertex_color(1) * s.x + vertex_color(2) * s.y;
+    }
+    return vertex_color(3) * (s.x + s.y - 1.0) + vertex_color(1) * (1.0 - s.y) + vertex_color(2) * (1.0 - s.x);
+}
+
+void main() {
+    uint tile = (gl_WorkGroupID.y * u_tile_count.x + gl_WorkGroupID.x) * bt_text2d_tile_stride;
+    if (gl_LocalInvocationIndex == 0) {
+        // Binned in whatever order the bin pass ran in, but blended in
+        // instance order like the glyph quads
+        uint count = min(tiles[tile], bt_text2d_tile_max_glyphs);
+        for (uint i = 0; i < count; i += 1) {
+            uint index = tiles[tile + 1 + i];
+            uint j = i;
+            for (; j > 0 && tile_glyphs[j - 1] > index; j -= 1) {
+                tile_glyphs[j] = tile_glyphs[j - 1];
+            }
+            tile_glyphs[j] = index;
+        }
+        tile_glyph_count = count;
+        // Empty for the next frame's bin pass
+        tiles[tile] = 0;
+    }
+    barrier();
+
+    uvec2 pixel = gl_GlobalInvocationID.xy;
+    if (any(greaterThanEqual(pixel, u_size))) {
+        return;
+    }
+    vec2 ndc = (vec2(pixel) + 0.5) / vec2(u_size) * 2.0 - 1.0;
+    ndc.y = -ndc.y;
+
+    // Premultiplied, blended back to front
+    vec4 color = vec4(0.0);
+    for (uint i = 0; i < tile_glyph_count; i += 1) {
+        bt_glyph2d instance = load_glyph2d(tile_glyphs[i]);
+        vec2 bounds_min;
+        vec2 bounds_max;
+        glyph2d_bounds(instance, bounds_min, bounds_max);
+        mat3 model = glyph2d_model(instance);
+        mat2 inverse_model = inverse(mat2(model[0].xy, model[1].xy));
+        vec2 pos = inverse_model * (ndc - model[2].xy);
+        vec2 uv = vec2(pos.x + 0.5, 0.5 - pos.y);
+        vec2 s = (uv - bounds_min) / (bounds_max - bounds_min);
+        if (any(lessThan(s, vec2(0.0))) || any(greaterThanEqual(s, vec2(1.0)))) {
+            continue;
+        }
+
+        // What fwidth(uv) is for the glyph quad's fragments
+        vec2 uv_per_pixel = abs(inverse_model * vec2(2.0 / float(u_size.x), 0.0)) + abs(inverse_model * vec2(0.0, 2.0 / float(u_size.y)));
+        vec4 outline_color = unpackUnorm4x8(instance.run.outline_color);
+        vec4 shadow_color = unpackUnorm4x8(instance.run.shadow_color);
+        float outline_width = glyph2d_outline_width(instance);
+        uint glyph = glyph2d_glyph(instance);
+        vec4 glyph_color;
+        if ((outline_width > 0.0 && outline_color.a > 0.0) || shadow_color.a > 0.0) {
+            glyph_color = effects_coverage(uv, uv_per_pixel, glyph, 0, quad_color(s), outline_width, outline_color, glyph2d_shadow_offset(instance), shadow_color);
+        } else {
+            float alpha = clamp(analytic_coverage(uv, uv_per_pixel, glyph, 0), 0.0, 1.0);
+            glyph_color = vec4(quad_color(s) * alpha, alpha);
+        }
+        if (glyph_color.a <= 0.0) {
+            continue;
+        }
+        color = glyph_color + color * (1.0 - glyph_color.a);
+    }
+
+    imageStore(text2d, ivec2(pixel), color.a > 0.0 ? vec4(color.rgb / color.a, color.a) : vec4(0.0));
+}
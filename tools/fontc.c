@@ -0,0 +1,1433 @@
+/*
+ * Font compiler. Reads a TrueType/OpenType font and writes a font pack with the
+ * curve, curve info, metrics, band and cmap sections that src/font.c maps at
+ * runtime.
+ *
+ * Usage: fontc [-m max_codepoint] <font file> <output pack>
+ *
+ * Every glyph of the font up to the maximum codepoint is compiled, and
+ * codepoints mapping to the same glyph share it.
+ */
+#include "data.h"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+constexpr uint32_t bt_fontc_max_codepoint = 0x10FFFF;
+constexpr uint32_t bt_fontc_cmap_page_count =
+    (bt_fontc_max_codepoint >> bt_font_cmap_page_bits) + 1;
+/*
+ * Maximum distance in em-box units between a cubic segment and the quadratic
+ * curves approximating it
+ */
+constexpr float bt_fontc_cubic_tolerance = 1.0f / 2048.0f;
+constexpr int bt_fontc_cubic_max_depth = 8;
+/*
+ * Glyphs get one band per this many curves, up to the maximum band count
+ */
+constexpr uint32_t bt_fontc_curves_per_band = 4;
+constexpr uint32_t bt_fontc_max_bands = 16;
+/*
+ * Curves are split into this many pieces to find the occupancy grid cells
+ * they cross
+ */
+constexpr uint32_t bt_fontc_grid_curve_pieces = 8;
+/*
+ * Maximum distance in glyph quad units between the simplified outline of each
+ * level of detail and the full one, see bt_font_lod_count. At the sizes
+ * src/glyph_3d.vert.glsl picks the levels at, that's under a quarter of a
+ * pixel.
+ */
+static double const bt_fontc_lod_tolerances[bt_font_lod_count] = {
+    0.0,
+    1.0 / 256.0,
+    1.0 / 64.0,
+};
+/*
+ * Most curves of a contour merged into one, and the points each of them is
+ * sampled at to check the merged curve against them
+ */
+constexpr uint32_t bt_fontc_lod_max_run = 16;
+constexpr uint32_t bt_fontc_lod_samples = 8;
+
+struct bt_fontc_curves {
+  struct bt_font_curve *data;
+  uint32_t len;
+  uint32_t capacity;
+};
+
+struct bt_fontc_uints {
+  uint32_t *data;
+  uint32_t len;
+  uint32_t capacity;
+};
+
+struct bt_fontc_cmap {
+  /*
+   * Indexed by codepoint >> bt_font_cmap_page_bits, null for pages without
+   * any glyphs
+   */
+  uint32_t *pages[bt_fontc_cmap_page_count];
+};
+
+struct bt_fontc_band_curve {
+  uint32_t index;
+  uint16_t max;
+};
+
+/*
+ * `contours` holds the index of the first curve of every contour
+ */
+struct bt_fontc_outline {
+  struct bt_fontc_curves *curves;
+  struct bt_fontc_uints *contours;
+  float scale;
+  float ascender;
+  bool failed;
+  float pen[2];
+};
+
+/*
+ * A component of a composite glyph, offset in grid steps
+ */
+struct bt_fontc_component {
+  uint32_t glyph;
+  int32_t offset[2];
+};
+
+/*
+ * The glyphs compiled so far. `map` maps the font's glyph indices to ours, 0
+ * if not compiled yet.
+ */
+struct bt_fontc_glyphs {
+  FT_Face face;
+  struct bt_fontc_outline outline;
+  struct bt_fontc_uints *bands;
+  struct bt_font_curve_info *infos;
+  struct bt_font_metrics *metrics;
+  uint32_t *map;
+  uint32_t count;
+};
+
+/*
+ * Marks glyphs in `map` whose components are being compiled, so that
+ * composites referring to themselves are flattened instead
+ */
+constexpr uint32_t bt_fontc_glyph_in_progress = UINT32_MAX;
+
+static void bt_fontc_to_uv(struct bt_fontc_outline const outline[static 1],
+                           FT_Vector const v[static 1], float out[static 2]) {
+  out[0] = (float)v->x * outline->scale;
+  out[1] = (outline->ascender - (float)v->y) * outline->scale;
+}
+
+static uint16_t bt_fontc_quantize(float v) {
+  float steps = (v - bt_font_curve_min) / bt_font_curve_step;
+  if (steps < 0.0f || steps > (float)UINT16_MAX) {
+    fprintf(stderr, "fontc: outline point %f is outside the encodable range\n",
+            (double)v);
+    steps = fminf(fmaxf(steps, 0.0f), (float)UINT16_MAX);
+  }
+  return (uint16_t)lroundf(steps);
+}
+
+/*
+ * Exact, since the grid values are representable as floats
+ */
+static float bt_fontc_dequantize(uint16_t v) {
+  return (float)v * bt_font_curve_step + bt_font_curve_min;
+}
+
+static bool bt_fontc_uints_reserve(struct bt_fontc_uints bands[static 1],
+                                   uint32_t count) {
+  if (bands->len + count <= bands->capacity) {
+    return true;
+  }
+  uint32_t capacity = bands->capacity ? bands->capacity : 1024;
+  while (capacity < bands->len + count) {
+    capacity *= 2;
+  }
+  uint32_t *data = realloc(bands->data, capacity * sizeof(*bands->data));
+  if (!data) {
+    return false;
+  }
+  bands->data = data;
+  bands->capacity = capacity;
+  return true;
+}
+
+static void bt_fontc_append_curve(struct bt_fontc_outline outline[static 1],
+                                  struct bt_font_curve const curve[static 1]) {
+  // Curves that are a single point never cross a ray
+  if (memcmp(curve->p0, curve->p1, sizeof(curve->p0)) == 0 &&
+      memcmp(curve->p1, curve->p2, sizeof(curve->p1)) == 0) {
+    return;
+  }
+
+  struct bt_fontc_curves *curves = outline->curves;
+  if (curves->len == curves->capacity) {
+    uint32_t capacity = curves->capacity ? curves->capacity * 2 : 1024;
+    struct bt_font_curve *data =
+        realloc(curves->data, capacity * sizeof(*curves->data));
+    if (!data) {
+      outline->failed = true;
+      return;
+    }
+    curves->data = data;
+    curves->capacity = capacity;
+  }
+  curves->data[curves->len] = *curve;
+  curves->len += 1;
+}
+
+/*
+ * Appends the curve, split at its extremum along `axis` and then along the
+ * lower axes, so that the pieces are monotonic in both y and x. That lets the
+ * fragment shader solve for a single root along either ray. Splitting a curve
+ * that is monotonic in one axis keeps its pieces monotonic in it even after
+ * quantization, since rounding preserves the order of the control points.
+ */
+static void
+bt_fontc_append_monotonic(struct bt_fontc_outline outline[static 1],
+                          struct bt_font_curve const curve[static 1],
+                          int axis) {
+  if (axis < 0) {
+    bt_fontc_append_curve(outline, curve);
+    return;
+  }
+
+  int32_t v0 = curve->p0[axis];
+  int32_t v1 = curve->p1[axis];
+  int32_t v2 = curve->p2[axis];
+  if ((v1 - v0) * (v1 - v2) <= 0) {
+    bt_fontc_append_monotonic(outline, curve, axis - 1);
+    return;
+  }
+
+  float t = (float)(v0 - v1) / (float)(v0 - 2 * v1 + v2);
+  uint16_t q0[2];
+  uint16_t q1[2];
+  uint16_t mid[2];
+  for (int i = 0; i < 2; i += 1) {
+    float a = bt_fontc_dequantize(curve->p0[i]);
+    float b = bt_fontc_dequantize(curve->p1[i]);
+    float c = bt_fontc_dequantize(curve->p2[i]);
+    float ab = a + (b - a) * t;
+    float bc = b + (c - b) * t;
+    q0[i] = bt_fontc_quantize(ab);
+    q1[i] = bt_fontc_quantize(bc);
+    mid[i] = bt_fontc_quantize(ab + (bc - ab) * t);
+  }
+  // The tangent at the extremum is parallel to the other axis
+  q0[axis] = mid[axis];
+  q1[axis] = mid[axis];
+
+  bt_fontc_append_monotonic(outline,
+                            &(struct bt_font_curve){
+                                .p0 = {curve->p0[0], curve->p0[1]},
+                                .p1 = {q0[0], q0[1]},
+                                .p2 = {mid[0], mid[1]},
+                            },
+                            axis - 1);
+  bt_fontc_append_monotonic(outline,
+                            &(struct bt_font_curve){
+                                .p0 = {mid[0], mid[1]},
+                                .p1 = {q1[0], q1[1]},
+                                .p2 = {curve->p2[0], curve->p2[1]},
+                            },
+                            axis - 1);
+}
+
+static void bt_fontc_push_curve(struct bt_fontc_outline outline[static 1],
+                                float const p0[static 2],
+                                float const p1[static 2],
+                                float const p2[static 2]) {
+  struct bt_font_curve curve = {
+      .p0 = {bt_fontc_quantize(p0[0]), bt_fontc_quantize(p0[1])},
+      .p1 = {bt_fontc_quantize(p1[0]), bt_fontc_quantize(p1[1])},
+      .p2 = {bt_fontc_quantize(p2[0]), bt_fontc_quantize(p2[1])},
+  };
+  bt_fontc_append_monotonic(outline, &curve, 1);
+}
+
+static int bt_fontc_move_to(FT_Vector const *to, void *user) {
+  struct bt_fontc_outline *outline = user;
+  struct bt_fontc_uints *contours = outline->contours;
+  if (!bt_fontc_uints_reserve(contours, 1)) {
+    outline->failed = true;
+    return 1;
+  }
+  contours->data[contours->len] = outline->curves->len;
+  contours->len += 1;
+  bt_fontc_to_uv(outline, to, outline->pen);
+  return 0;
+}
+
+static int bt_fontc_line_to(FT_Vector const *to, void *user) {
+  struct bt_fontc_outline *outline = user;
+  float p2[2];
+  bt_fontc_to_uv(outline, to, p2);
+  float p1[2] = {
+      0.5f * (outline->pen[0] + p2[0]),
+      0.5f * (outline->pen[1] + p2[1]),
+  };
+  bt_fontc_push_curve(outline, outline->pen, p1, p2);
+  outline->pen[0] = p2[0];
+  outline->pen[1] = p2[1];
+  return outline->failed;
+}
+
+static int bt_fontc_conic_to(FT_Vector const *control, FT_Vector const *to,
+                             void *user) {
+  struct bt_fontc_outline *outline = user;
+  float p1[2];
+  float p2[2];
+  bt_fontc_to_uv(outline, control, p1);
+  bt_fontc_to_uv(outline, to, p2);
+  bt_fontc_push_curve(outline, outline->pen, p1, p2);
+  outline->pen[0] = p2[0];
+  outline->pen[1] = p2[1];
+  return outline->failed;
+}
+
+/*
+ * Approximates the cubic with a single quadratic if it is within tolerance,
+ * otherwise splits it in half and tries again for both halves.
+ */
+static void bt_fontc_cubic_to_quadratics(
+    struct bt_fontc_outline outline[static 1], float const p0[static 2],
+    float const c0[static 2], float const c1[static 2],
+    float const p1[static 2], int depth) {
+  float d[2] = {
+      p1[0] - 3.0f * c1[0] + 3.0f * c0[0] - p0[0],
+      p1[1] - 3.0f * c1[1] + 3.0f * c0[1] - p0[1],
+  };
+  float error = sqrtf(d[0] * d[0] + d[1] * d[1]) * (sqrtf(3.0f) / 36.0f);
+  if (error <= bt_fontc_cubic_tolerance || depth >= bt_fontc_cubic_max_depth) {
+    float q[2] = {
+        (3.0f * (c0[0] + c1[0]) - p0[0] - p1[0]) * 0.25f,
+        (3.0f * (c0[1] + c1[1]) - p0[1] - p1[1]) * 0.25f,
+    };
+    bt_fontc_push_curve(outline, p0, q, p1);
+    return;
+  }
+
+  float ab[2];
+  float bc[2];
+  float cd[2];
+  float abc[2];
+  float bcd[2];
+  float mid[2];
+  for (int i = 0; i < 2; i += 1) {
+    ab[i] = 0.5f * (p0[i] + c0[i]);
+    bc[i] = 0.5f * (c0[i] + c1[i]);
+    cd[i] = 0.5f * (c1[i] + p1[i]);
+    abc[i] = 0.5f * (ab[i] + bc[i]);
+    bcd[i] = 0.5f * (bc[i] + cd[i]);
+    mid[i] = 0.5f * (abc[i] + bcd[i]);
+  }
+  bt_fontc_cubic_to_quadratics(outline, p0, ab, abc, mid, depth + 1);
+  bt_fontc_cubic_to_quadratics(outline, mid, bcd, cd, p1, depth + 1);
+}
+
+static int bt_fontc_cubic_to(FT_Vector const *control0,
+                             FT_Vector const *control1, FT_Vector const *to,
+                             void *user) {
+  struct bt_fontc_outline *outline = user;
+  float c0[2];
+  float c1[2];
+  float p1[2];
+  bt_fontc_to_uv(outline, control0, c0);
+  bt_fontc_to_uv(outline, control1, c1);
+  bt_fontc_to_uv(outline, to, p1);
+  bt_fontc_cubic_to_quadratics(outline, outline->pen, c0, c1, p1, 0);
+  outline->pen[0] = p1[0];
+  outline->pen[1] = p1[1];
+  return outline->failed;
+}
+
+/*
+ * The fragment shader expects outer contours to be counter-clockwise in font
+ * space, which is the PostScript convention. TrueType uses the opposite, so
+ * this reverses the contours from `contours[first]` on. Each stays in contour
+ * order, with every curve starting where the one before it ends.
+ */
+static void
+bt_fontc_reverse_contours(struct bt_fontc_outline outline[static 1],
+                          uint32_t first) {
+  struct bt_fontc_uints const *contours = outline->contours;
+  struct bt_font_curve *curves = outline->curves->data;
+  for (uint32_t contour = first; contour < contours->len; contour += 1) {
+    uint32_t start = contours->data[contour];
+    uint32_t end = contour + 1 < contours->len ? contours->data[contour + 1]
+                                               : outline->curves->len;
+    for (uint32_t i = start; i < end; i += 1) {
+      uint16_t p0[2] = {curves[i].p0[0], curves[i].p0[1]};
+      memcpy(curves[i].p0, curves[i].p2, sizeof(p0));
+      memcpy(curves[i].p2, p0, sizeof(p0));
+    }
+    for (uint32_t i = start, j = end; i + 1 < j; i += 1) {
+      j -= 1;
+      struct bt_font_curve curve = curves[i];
+      curves[i] = curves[j];
+      curves[j] = curve;
+    }
+  }
+}
+
+static FT_Outline_Funcs const bt_fontc_outline_funcs = {
+    .move_to = bt_fontc_move_to,
+    .line_to = bt_fontc_line_to,
+    .conic_to = bt_fontc_conic_to,
+    .cubic_to = bt_fontc_cubic_to,
+};
+
+/*
+ * Appends the outline of the font's glyph `glyph_index`, first used by
+ * codepoint `c`, to the curves, unless only the advance is needed for a
+ * composite glyph. Glyphs that fail to load are left empty. Returns false on
+ * fatal errors.
+ */
+static bool bt_fontc_compile_glyph(FT_Face face, FT_UInt glyph_index,
+                                   uint32_t c, bool decompose,
+                                   struct bt_fontc_outline outline[static 1],
+                                   struct bt_font_metrics metrics[static 1]) {
+  if (FT_Load_Glyph(face, glyph_index,
+                    FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP)) {
+    fprintf(stderr, "fontc: failed to load glyph for U+%04X\n", c);
+    return true;
+  }
+
+  FT_GlyphSlot glyph = face->glyph;
+  metrics->advance = (float)glyph->metrics.horiAdvance * outline->scale;
+  if (!decompose || glyph->format != FT_GLYPH_FORMAT_OUTLINE) {
+    return true;
+  }
+
+  uint32_t first_contour = outline->contours->len;
+  if (FT_Outline_Decompose(&glyph->outline, &bt_fontc_outline_funcs,
+                           outline) ||
+      outline->failed) {
+    fprintf(stderr, "fontc: failed to decompose glyph for U+%04X\n", c);
+    return false;
+  }
+  if (FT_Outline_Get_Orientation(&glyph->outline) == FT_ORIENTATION_TRUETYPE) {
+    bt_fontc_reverse_contours(outline, first_contour);
+  }
+
+  return true;
+}
+
+/*
+ * Computes the bounding box of the glyph's control points. The curves stay
+ * inside the hull of their control points, so this bounds the outline too.
+ */
+static void
+bt_fontc_compute_bounds(struct bt_font_curve const curves[],
+                        struct bt_font_curve_info const info[static 1],
+                        struct bt_font_metrics metrics[static 1]) {
+  uint16_t bounds[4] = {UINT16_MAX, UINT16_MAX, 0, 0};
+  for (uint32_t i = info->start; i < info->end; i += 1) {
+    uint16_t const *points[] = {curves[i].p0, curves[i].p1, curves[i].p2};
+    for (int j = 0; j < 3; j += 1) {
+      for (int axis = 0; axis < 2; axis += 1) {
+        uint16_t v = points[j][axis];
+        bounds[axis] = v < bounds[axis] ? v : bounds[axis];
+        bounds[axis + 2] = v > bounds[axis + 2] ? v : bounds[axis + 2];
+      }
+    }
+  }
+  memcpy(metrics->bounds, bounds, sizeof(bounds));
+}
+
+static bool bt_fontc_cmap_set(struct bt_fontc_cmap cmap[static 1],
+                              uint32_t codepoint, uint32_t glyph) {
+  uint32_t **page = &cmap->pages[codepoint >> bt_font_cmap_page_bits];
+  if (!*page) {
+    *page = calloc(bt_font_cmap_page_size, sizeof(**page));
+    if (!*page) {
+      return false;
+    }
+  }
+  (*page)[codepoint & (bt_font_cmap_page_size - 1)] = glyph;
+  return true;
+}
+
+/*
+ * Writes the page table in the format described in data.h, with only the
+ * pages up to the last non-empty one.
+ */
+static bool bt_fontc_cmap_serialize(struct bt_fontc_cmap const cmap[static 1],
+                                    struct bt_fontc_uints out[static 1]) {
+  uint32_t page_count = 0;
+  for (uint32_t i = 0; i < bt_fontc_cmap_page_count; i += 1) {
+    if (cmap->pages[i]) {
+      page_count = i + 1;
+    }
+  }
+
+  uint32_t empty_page = 1 + page_count;
+  if (!bt_fontc_uints_reserve(out, empty_page + bt_font_cmap_page_size)) {
+    return false;
+  }
+  out->data[0] = page_count;
+  memset(&out->data[empty_page], 0,
+         bt_font_cmap_page_size * sizeof(*out->data));
+  out->len = empty_page + bt_font_cmap_page_size;
+
+  for (uint32_t i = 0; i < page_count; i += 1) {
+    if (!cmap->pages[i]) {
+      out->data[1 + i] = empty_page;
+      continue;
+    }
+    if (!bt_fontc_uints_reserve(out, bt_font_cmap_page_size)) {
+      return false;
+    }
+    out->data[1 + i] = out->len;
+    memcpy(&out->data[out->len], cmap->pages[i],
+           bt_font_cmap_page_size * sizeof(*out->data));
+    out->len += bt_font_cmap_page_size;
+  }
+
+  return true;
+}
+
+static int bt_fontc_compare_band_curves(void const *a, void const *b) {
+  uint16_t max_a = ((struct bt_fontc_band_curve const *)a)->max;
+  uint16_t max_b = ((struct bt_fontc_band_curve const *)b)->max;
+  return (max_a < max_b) - (max_a > max_b);
+}
+
+/*
+ * Writes the list of curves crossing each of the glyph's `band_count` bands
+ * along `axis`, horizontal bands for y and vertical ones for x, sorted by
+ * descending maximum along the other axis. The start and end of the lists go
+ * to the pairs starting at bands[header]. Curves parallel to the bands never
+ * cross a ray along them and are left out.
+ */
+static bool bt_fontc_build_band_lists(
+    struct bt_fontc_uints bands[static 1], struct bt_font_curve const curves[],
+    struct bt_font_curve_info const info[static 1], uint32_t header, int axis,
+    struct bt_fontc_band_curve band_curves[]) {
+  uint32_t band_count = info->band_count;
+  for (uint32_t band = 0; band < band_count; band += 1) {
+    // The first and last bands also cover anything outside the quad
+    float band_min = band == 0 ? -INFINITY : (float)band / (float)band_count;
+    float band_max = band == band_count - 1
+                         ? INFINITY
+                         : (float)(band + 1) / (float)band_count;
+    uint32_t count = 0;
+    for (uint32_t i = info->start; i < info->end; i += 1) {
+      // Use the same quantized values as the shader so the sort is exact
+      struct bt_font_curve const *curve = &curves[i];
+      uint16_t min = curve->p0[axis];
+      uint16_t max = curve->p0[axis];
+      uint16_t ray_max = curve->p0[1 - axis];
+      for (int j = 0; j < 2; j += 1) {
+        uint16_t const *p = j == 0 ? curve->p1 : curve->p2;
+        min = p[axis] < min ? p[axis] : min;
+        max = p[axis] > max ? p[axis] : max;
+        ray_max = p[1 - axis] > ray_max ? p[1 - axis] : ray_max;
+      }
+      if (min == max || bt_fontc_dequantize(max) < band_min ||
+          bt_fontc_dequantize(min) > band_max) {
+        continue;
+      }
+      band_curves[count] = (struct bt_fontc_band_curve){
+          .index = i - info->start,
+          .max = ray_max,
+      };
+      count += 1;
+    }
+    qsort(band_curves, count, sizeof(*band_curves),
+          bt_fontc_compare_band_curves);
+
+    if (!bt_fontc_uints_reserve(bands, count)) {
+      return false;
+    }
+    bands->data[header + 2 * band] = bands->len;
+    for (uint32_t i = 0; i < count; i += 1) {
+      bands->data[bands->len] =
+          (uint32_t)band_curves[i].max << bt_font_band_index_bits |
+          band_curves[i].index;
+      bands->len += 1;
+    }
+    bands->data[header + 2 * band + 1] = bands->len;
+  }
+
+  return true;
+}
+
+static void bt_fontc_curve_point(struct bt_font_curve const curve[static 1],
+                                 double t, double out[static 2]) {
+  for (int axis = 0; axis < 2; axis += 1) {
+    double p0 = bt_fontc_dequantize(curve->p0[axis]);
+    double p1 = bt_fontc_dequantize(curve->p1[axis]);
+    double p2 = bt_fontc_dequantize(curve->p2[axis]);
+    out[axis] = (1.0 - t) * (1.0 - t) * p0 + 2.0 * t * (1.0 - t) * p1 +
+                t * t * p2;
+  }
+}
+
+/*
+ * Winding number of the glyph's outline around p, counting the crossings of
+ * the ray towards +x like the fragment shader does
+ */
+static int bt_fontc_winding(struct bt_font_curve const curves[],
+                            struct bt_font_curve_info const info[static 1],
+                            double const p[static 2]) {
+  int winding = 0;
+  for (uint32_t i = info->start; i < info->end; i += 1) {
+    double p0[2];
+    double p1[2];
+    double p2[2];
+    for (int axis = 0; axis < 2; axis += 1) {
+      p0[axis] = bt_fontc_dequantize(curves[i].p0[axis]);
+      p1[axis] = bt_fontc_dequantize(curves[i].p1[axis]);
+      p2[axis] = bt_fontc_dequantize(curves[i].p2[axis]);
+    }
+    double y0 = p0[1] - p[1];
+    double y2 = p2[1] - p[1];
+    if ((y0 > 0.0) == (y2 > 0.0)) {
+      continue;
+    }
+    double direction = y0 > 0.0 ? 1.0 : -1.0;
+    double a[2] = {p0[0] - 2.0 * p1[0] + p2[0], p0[1] - 2.0 * p1[1] + p2[1]};
+    double b[2] = {p0[0] - p1[0], p0[1] - p1[1]};
+    double root = sqrt(fmax(b[1] * b[1] - a[1] * y0, 0.0));
+    double denominator = b[1] + direction * root;
+    double t = fabs(denominator) > 0.0 ? y0 / denominator : 0.0;
+    if ((a[0] * t - 2.0 * b[0]) * t + p0[0] > p[0]) {
+      winding += y0 > 0.0 ? 1 : -1;
+    }
+  }
+  return winding;
+}
+
+/*
+ * Writes the occupancy grid described in data.h. Cells that a curve passes
+ * within a grid step of, to allow for rounding in the fragment shader, are
+ * edge cells. The others are solid if their center is inside the outline.
+ */
+static void bt_fontc_build_grid(struct bt_font_curve const curves[],
+                                struct bt_font_curve_info const info[static 1],
+                                struct bt_font_metrics const metrics[static 1],
+                                uint32_t grid[static bt_font_grid_words]) {
+  uint16_t min[2] = {metrics->bounds[0], metrics->bounds[1]};
+  uint16_t max[2];
+  for (int axis = 0; axis < 2; axis += 1) {
+    // The grid needs an area even if the outline doesn't have one
+    max[axis] = metrics->bounds[axis + 2] > min[axis]
+                    ? metrics->bounds[axis + 2]
+                    : (uint16_t)(min[axis] + 1);
+  }
+  grid[0] = (uint32_t)min[1] << 16 | min[0];
+  grid[1] = (uint32_t)max[1] << 16 | max[0];
+
+  double origin[2];
+  double cell_size[2];
+  for (int axis = 0; axis < 2; axis += 1) {
+    origin[axis] = bt_fontc_dequantize(min[axis]);
+    cell_size[axis] = ((double)bt_fontc_dequantize(max[axis]) - origin[axis]) /
+                      (double)bt_font_grid_size;
+  }
+
+  bool edge[bt_font_grid_size][bt_font_grid_size] = {};
+  for (uint32_t i = info->start; i < info->end; i += 1) {
+    double from[2];
+    bt_fontc_curve_point(&curves[i], 0.0, from);
+    for (uint32_t piece = 1; piece <= bt_fontc_grid_curve_pieces; piece += 1) {
+      double to[2];
+      bt_fontc_curve_point(&curves[i],
+                           (double)piece / (double)bt_fontc_grid_curve_pieces,
+                           to);
+      // The pieces are monotonic too, so their ends bound them
+      int cell_min[2];
+      int cell_max[2];
+      for (int axis = 0; axis < 2; axis += 1) {
+        double low = fmin(from[axis], to[axis]) - (double)bt_font_curve_step;
+        double high = fmax(from[axis], to[axis]) + (double)bt_font_curve_step;
+        cell_min[axis] = (int)fmax(
+            floor((low - origin[axis]) / cell_size[axis]), 0.0);
+        cell_max[axis] =
+            (int)fmin(floor((high - origin[axis]) / cell_size[axis]),
+                      (double)(bt_font_grid_size - 1));
+      }
+      for (int y = cell_min[1]; y <= cell_max[1]; y += 1) {
+        for (int x = cell_min[0]; x <= cell_max[0]; x += 1) {
+          edge[y][x] = true;
+        }
+      }
+      memcpy(from, to, sizeof(from));
+    }
+  }
+
+  for (uint32_t y = 0; y < bt_font_grid_size; y += 1) {
+    grid[2 + y] = 0;
+    for (uint32_t x = 0; x < bt_font_grid_size; x += 1) {
+      double center[2] = {
+          origin[0] + ((double)x + 0.5) * cell_size[0],
+          origin[1] + ((double)y + 0.5) * cell_size[1],
+      };
+      uint32_t cell = edge[y][x] ? bt_font_grid_edge
+                      : bt_fontc_winding(curves, info, center) > 0
+                          ? bt_font_grid_solid
+                          : bt_font_grid_empty;
+      grid[2 + y] |= cell << (bt_font_grid_bits * x);
+    }
+  }
+}
+
+/*
+ * Splits the glyph quad into horizontal and vertical bands, at least
+ * `min_band_count` of them, and writes the list of curves crossing each of
+ * them, after the glyph's occupancy grid.
+ */
+static bool
+bt_fontc_build_bands(struct bt_fontc_uints bands[static 1],
+                     struct bt_font_curve const curves[],
+                     struct bt_font_curve_info info[static 1],
+                     struct bt_font_metrics const metrics[static 1],
+                     uint32_t min_band_count) {
+  uint32_t curve_count = info->end - info->start;
+  if (curve_count == 0) {
+    // The empty bands at the start of the buffer
+    info->band_start = 0;
+    info->band_count = 1;
+    return true;
+  }
+  if (curve_count > bt_font_band_index_mask + 1) {
+    fprintf(stderr, "fontc: glyph has more than %u curves\n",
+            bt_font_band_index_mask + 1);
+    return false;
+  }
+
+  uint32_t band_count =
+      (curve_count + bt_fontc_curves_per_band - 1) / bt_fontc_curves_per_band;
+  if (band_count < min_band_count) {
+    band_count = min_band_count;
+  }
+  if (band_count > bt_fontc_max_bands) {
+    band_count = bt_fontc_max_bands;
+  }
+
+  struct bt_fontc_band_curve *band_curves =
+      malloc(curve_count * sizeof(*band_curves));
+  if (!band_curves ||
+      !bt_fontc_uints_reserve(bands, 4 * band_count + bt_font_grid_words)) {
+    free(band_curves);
+    return false;
+  }
+  info->band_start = bands->len;
+  info->band_count = band_count;
+  bands->len += 4 * band_count;
+  bt_fontc_build_grid(curves, info, metrics, &bands->data[bands->len]);
+  bands->len += bt_font_grid_words;
+
+  bool built = bt_fontc_build_band_lists(bands, curves, info, info->band_start,
+                                         1, band_curves) &&
+               bt_fontc_build_band_lists(bands, curves, info,
+                                         info->band_start + 2 * band_count, 0,
+                                         band_curves);
+  free(band_curves);
+  return built;
+}
+
+/*
+ * Sets `components` to the components of the font's glyph if it is a
+ * composite glyph whose components are only moved, not scaled or rotated, and
+ * to nullptr otherwise. Returns false on fatal errors.
+ */
+static bool
+bt_fontc_load_components(struct bt_fontc_glyphs const glyphs[static 1],
+                         FT_UInt font_glyph,
+                         struct bt_fontc_component *components[static 1],
+                         uint32_t count[static 1]) {
+  *components = nullptr;
+  *count = 0;
+  FT_Face face = glyphs->face;
+  if (FT_Load_Glyph(face, font_glyph,
+                    FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP |
+                        FT_LOAD_NO_RECURSE) ||
+      face->glyph->format != FT_GLYPH_FORMAT_COMPOSITE ||
+      face->glyph->num_subglyphs == 0) {
+    return true;
+  }
+
+  uint32_t subglyph_count = face->glyph->num_subglyphs;
+  struct bt_fontc_component *out = malloc(subglyph_count * sizeof(*out));
+  if (!out) {
+    return false;
+  }
+  for (uint32_t i = 0; i < subglyph_count; i += 1) {
+    FT_Int index;
+    FT_UInt flags;
+    FT_Int x;
+    FT_Int y;
+    FT_Matrix transform;
+    if (FT_Get_SubGlyph_Info(face->glyph, i, &index, &flags, &x, &y,
+                             &transform) ||
+        index < 0 || index >= face->num_glyphs ||
+        !(flags & FT_SUBGLYPH_FLAG_ARGS_ARE_XY_VALUES) ||
+        (flags & (FT_SUBGLYPH_FLAG_SCALE | FT_SUBGLYPH_FLAG_XY_SCALE |
+                  FT_SUBGLYPH_FLAG_2X2))) {
+      free(out);
+      return true;
+    }
+    // Font units point up, ours down
+    float scale = glyphs->outline.scale / bt_font_curve_step;
+    out[i] = (struct bt_fontc_component){
+        .glyph = (uint32_t)index,
+        .offset = {(int32_t)lroundf((float)x * scale),
+                   (int32_t)lroundf(-(float)y * scale)},
+    };
+  }
+
+  *components = out;
+  *count = subglyph_count;
+  return true;
+}
+
+/*
+ * Writes the components of the composite glyph, with the components of any
+ * nested composite glyphs in their place, and sets its bounds. Returns false
+ * if that isn't possible or on fatal errors, setting `fatal` in the latter
+ * case.
+ */
+static bool bt_fontc_push_composite(
+    struct bt_fontc_glyphs glyphs[static 1], uint32_t glyph,
+    struct bt_fontc_component const components[], uint32_t count,
+    bool fatal[static 1]) {
+  struct bt_fontc_uints *bands = glyphs->bands;
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < count; i += 1) {
+    struct bt_font_curve_info const *info = &glyphs->infos[components[i].glyph];
+    total += info->band_count == 0 ? bands->data[info->band_start] : 1;
+  }
+  if (!bt_fontc_uints_reserve(bands, 1 + 2 * total)) {
+    *fatal = true;
+    return false;
+  }
+
+  uint32_t start = bands->len;
+  uint32_t len = start + 1;
+  // Stays empty, with the min greater than the max, without any curves
+  int32_t bounds[4] = {UINT16_MAX, UINT16_MAX, 0, 0};
+  for (uint32_t i = 0; i < count; i += 1) {
+    struct bt_font_curve_info const *info = &glyphs->infos[components[i].glyph];
+    uint32_t nested_count = 1;
+    uint32_t const *nested = nullptr;
+    if (info->band_count == 0) {
+      nested_count = bands->data[info->band_start];
+      nested = &bands->data[info->band_start + 1];
+    }
+
+    for (uint32_t j = 0; j < nested_count; j += 1) {
+      uint32_t component = components[i].glyph;
+      int32_t offset[2] = {components[i].offset[0], components[i].offset[1]};
+      if (nested) {
+        component = nested[2 * j];
+        offset[0] += (int16_t)(nested[2 * j + 1] & 0xFFFF);
+        offset[1] += (int16_t)(nested[2 * j + 1] >> 16);
+      }
+      if (offset[0] < INT16_MIN || offset[0] > INT16_MAX ||
+          offset[1] < INT16_MIN || offset[1] > INT16_MAX) {
+        return false;
+      }
+      bands->data[len] = component;
+      bands->data[len + 1] =
+          (uint32_t)(uint16_t)offset[0] | (uint32_t)(uint16_t)offset[1] << 16;
+      len += 2;
+
+      uint16_t const *component_bounds = glyphs->metrics[component].bounds;
+      if (component_bounds[0] > component_bounds[2]) {
+        continue;
+      }
+      for (int axis = 0; axis < 2; axis += 1) {
+        int32_t min = component_bounds[axis] + offset[axis];
+        int32_t max = component_bounds[axis + 2] + offset[axis];
+        bounds[axis] = min < bounds[axis] ? min : bounds[axis];
+        bounds[axis + 2] = max > bounds[axis + 2] ? max : bounds[axis + 2];
+      }
+    }
+  }
+
+  bands->data[start] = total;
+  bands->len = len;
+  glyphs->infos[glyph] = (struct bt_font_curve_info){
+      .band_start = start,
+      .band_count = 0,
+  };
+  for (int i = 0; i < 4; i += 1) {
+    int32_t v = bounds[i];
+    glyphs->metrics[glyph].bounds[i] =
+        (uint16_t)(v < 0 ? 0 : v > UINT16_MAX ? UINT16_MAX : v);
+  }
+  return true;
+}
+
+/*
+ * Compiles the font's glyph `font_glyph`, first used by codepoint `c`, and the
+ * glyphs it is composed of, unless they are compiled already. Composite glyphs
+ * refer to their components, so the curves they share are only stored once.
+ * Returns our glyph index, or 0 on fatal errors.
+ */
+static uint32_t bt_fontc_add_glyph(struct bt_fontc_glyphs glyphs[static 1],
+                                   FT_UInt font_glyph, uint32_t c) {
+  if (glyphs->map[font_glyph] != 0) {
+    return glyphs->map[font_glyph];
+  }
+  glyphs->map[font_glyph] = bt_fontc_glyph_in_progress;
+
+  uint32_t glyph = 0;
+  struct bt_fontc_component *components;
+  uint32_t count;
+  if (!bt_fontc_load_components(glyphs, font_glyph, &components, &count)) {
+    fprintf(stderr, "fontc: out of memory\n");
+    return 0;
+  }
+  bool composite = components != nullptr;
+  for (uint32_t i = 0; composite && i < count; i += 1) {
+    if (glyphs->map[components[i].glyph] == bt_fontc_glyph_in_progress) {
+      composite = false;
+      break;
+    }
+    components[i].glyph = bt_fontc_add_glyph(glyphs, components[i].glyph, c);
+    if (components[i].glyph == 0) {
+      goto done;
+    }
+  }
+
+  glyph = glyphs->count;
+  glyphs->count += 1;
+  struct bt_font_curve_info *info = &glyphs->infos[glyph];
+  struct bt_font_metrics *metrics = &glyphs->metrics[glyph];
+  bool fatal = false;
+  if (composite && bt_fontc_push_composite(glyphs, glyph, components, count,
+                                           &fatal)) {
+    if (!bt_fontc_compile_glyph(glyphs->face, font_glyph, c, false,
+                                &glyphs->outline, metrics)) {
+      glyph = 0;
+    }
+    goto done;
+  }
+  if (fatal) {
+    fprintf(stderr, "fontc: out of memory\n");
+    glyph = 0;
+    goto done;
+  }
+
+  info->start = glyphs->outline.curves->len;
+  if (!bt_fontc_compile_glyph(glyphs->face, font_glyph, c, true,
+                              &glyphs->outline, metrics)) {
+    glyph = 0;
+    goto done;
+  }
+  info->end = glyphs->outline.curves->len;
+  bt_fontc_compute_bounds(glyphs->outline.curves->data, info, metrics);
+  if (!bt_fontc_build_bands(glyphs->bands, glyphs->outline.curves->data,
+                            info, metrics, 1)) {
+    fprintf(stderr, "fontc: out of memory\n");
+    glyph = 0;
+  }
+
+done:
+  free(components);
+  glyphs->map[font_glyph] = glyph;
+  return glyph;
+}
+
+/*
+ * Distance from p to the polyline through the points
+ */
+static double bt_fontc_polyline_distance(double const points[][2],
+                                         uint32_t count,
+                                         double const p[static 2]) {
+  double min = INFINITY;
+  for (uint32_t i = 0; i + 1 < count; i += 1) {
+    double d[2] = {points[i + 1][0] - points[i][0],
+                   points[i + 1][1] - points[i][1]};
+    double length = d[0] * d[0] + d[1] * d[1];
+    double t = length > 0.0 ? ((p[0] - points[i][0]) * d[0] +
+                               (p[1] - points[i][1]) * d[1]) /
+                                  length
+                            : 0.0;
+    t = fmin(fmax(t, 0.0), 1.0);
+    min = fmin(min, hypot(points[i][0] + d[0] * t - p[0],
+                          points[i][1] + d[1] * t - p[1]));
+  }
+  return min;
+}
+
+/*
+ * Fits one curve from the start of the first of the `count` consecutive curves
+ * to the end of the last one, keeping the tangents at both ends. Returns false
+ * if there is none within `tolerance` of them.
+ */
+static bool bt_fontc_fit_run(struct bt_font_curve const curves[],
+                             uint32_t count, double tolerance,
+                             struct bt_font_curve out[static 1]) {
+  struct bt_font_curve const *first = &curves[0];
+  struct bt_font_curve const *last = &curves[count - 1];
+  // The chord for curves whose middle control point is on one of their ends
+  uint16_t const *next =
+      memcmp(first->p1, first->p0, sizeof(first->p0)) ? first->p1 : first->p2;
+  uint16_t const *previous =
+      memcmp(last->p1, last->p2, sizeof(last->p2)) ? last->p1 : last->p0;
+  double p0[2];
+  double p2[2];
+  double d0[2];
+  double d1[2];
+  for (int axis = 0; axis < 2; axis += 1) {
+    p0[axis] = bt_fontc_dequantize(first->p0[axis]);
+    p2[axis] = bt_fontc_dequantize(last->p2[axis]);
+    d0[axis] = (double)bt_fontc_dequantize(next[axis]) - p0[axis];
+    d1[axis] = p2[axis] - (double)bt_fontc_dequantize(previous[axis]);
+  }
+
+  // Where the end tangents meet, or the middle of a straight run
+  double p1[2] = {0.5 * (p0[0] + p2[0]), 0.5 * (p0[1] + p2[1])};
+  double e[2] = {p2[0] - p0[0], p2[1] - p0[1]};
+  double cross = d0[0] * d1[1] - d0[1] * d1[0];
+  if (fabs(cross) > 1e-6 * hypot(d0[0], d0[1]) * hypot(d1[0], d1[1])) {
+    double s = (e[0] * d1[1] - e[1] * d1[0]) / cross;
+    double u = (d0[0] * e[1] - d0[1] * e[0]) / cross;
+    if (s <= 0.0 || u <= 0.0) {
+      return false;
+    }
+    p1[0] = p0[0] + d0[0] * s;
+    p1[1] = p0[1] + d0[1] * s;
+  }
+  for (int axis = 0; axis < 2; axis += 1) {
+    if (p1[axis] < (double)bt_font_curve_min ||
+        p1[axis] >= (double)(bt_font_curve_min + bt_font_curve_range)) {
+      return false;
+    }
+  }
+  *out = (struct bt_font_curve){
+      .p0 = {first->p0[0], first->p0[1]},
+      .p1 = {bt_fontc_quantize((float)p1[0]), bt_fontc_quantize((float)p1[1])},
+      .p2 = {last->p2[0], last->p2[1]},
+  };
+
+  // Each of the two has to stay close to the other
+  constexpr uint32_t max_points =
+      bt_fontc_lod_max_run * bt_fontc_lod_samples + 1;
+  double run[max_points][2];
+  double fit[max_points][2];
+  uint32_t point_count = count * bt_fontc_lod_samples + 1;
+  for (uint32_t i = 0; i < point_count; i += 1) {
+    uint32_t curve = i / bt_fontc_lod_samples;
+    double t = (double)(i % bt_fontc_lod_samples) / bt_fontc_lod_samples;
+    if (curve == count) {
+      curve -= 1;
+      t = 1.0;
+    }
+    bt_fontc_curve_point(&curves[curve], t, run[i]);
+    bt_fontc_curve_point(out, (double)i / (point_count - 1), fit[i]);
+  }
+  for (uint32_t i = 0; i < point_count; i += 1) {
+    if (bt_fontc_polyline_distance(fit, point_count, run[i]) > tolerance ||
+        bt_fontc_polyline_distance(run, point_count, fit[i]) > tolerance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Whether `next` starts where `curve` ends
+ */
+static bool bt_fontc_curve_follows(struct bt_font_curve const curve[static 1],
+                                   struct bt_font_curve const next[static 1]) {
+  return memcmp(curve->p2, next->p0, sizeof(curve->p2)) == 0;
+}
+
+/*
+ * Appends the contour with as many of its consecutive curves merged as
+ * `tolerance` allows, or nothing if the whole contour is closed and within it
+ */
+static void
+bt_fontc_simplify_contour(struct bt_fontc_outline outline[static 1],
+                          struct bt_font_curve const curves[],
+                          uint32_t count, double tolerance) {
+  if (count == 0) {
+    return;
+  }
+  struct bt_font_metrics bounds;
+  bt_fontc_compute_bounds(
+      curves, &(struct bt_font_curve_info){.start = 0, .end = count},
+      &bounds);
+  double size[2] = {
+      (bounds.bounds[2] - bounds.bounds[0]) * (double)bt_font_curve_step,
+      (bounds.bounds[3] - bounds.bounds[1]) * (double)bt_font_curve_step,
+  };
+  if (size[0] <= tolerance && size[1] <= tolerance &&
+      bt_fontc_curve_follows(&curves[count - 1], &curves[0])) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count;) {
+    struct bt_font_curve merged = curves[i];
+    uint32_t run = 1;
+    struct bt_font_curve fit;
+    while (i + run < count && run < bt_fontc_lod_max_run &&
+           bt_fontc_fit_run(&curves[i], run + 1, tolerance, &fit)) {
+      merged = fit;
+      run += 1;
+    }
+    // Merged curves may cross the extrema the run was split at
+    bt_fontc_append_monotonic(outline, &merged, 1);
+    i += run;
+  }
+}
+
+/*
+ * Appends the simplified outline of the glyph with the given curve info to the
+ * curves and sets `out` to its curve range. Contours are merged separately, so
+ * they stay closed. Returns false on fatal errors.
+ */
+static bool bt_fontc_simplify(struct bt_fontc_outline outline[static 1],
+                              struct bt_font_curve_info const info[static 1],
+                              double tolerance,
+                              struct bt_font_curve_info out[static 1]) {
+  uint32_t count = info->end - info->start;
+  struct bt_font_curve *curves = malloc(count * sizeof(*curves));
+  if (!curves) {
+    return false;
+  }
+  // Appending may move the curves
+  memcpy(curves, &outline->curves->data[info->start],
+         count * sizeof(*curves));
+
+  // The first contour of the glyph starts at its first curve
+  struct bt_fontc_uints const *contours = outline->contours;
+  uint32_t low = 0;
+  uint32_t high = contours->len;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (contours->data[middle] < info->start) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  out->start = outline->curves->len;
+  for (uint32_t contour = low;
+       contour < contours->len && contours->data[contour] < info->end;
+       contour += 1) {
+    uint32_t start = contours->data[contour];
+    uint32_t end = contour + 1 < contours->len &&
+                           contours->data[contour + 1] < info->end
+                       ? contours->data[contour + 1]
+                       : info->end;
+    bt_fontc_simplify_contour(outline, &curves[start - info->start],
+                              end - start, tolerance);
+  }
+  out->end = outline->curves->len;
+
+  free(curves);
+  return !outline->failed;
+}
+
+/*
+ * Writes the curve info of level `level` of every glyph after the ones of the
+ * levels before it, see bt_font_lod_count in data.h. Returns false on fatal
+ * errors.
+ */
+static bool bt_fontc_add_lod(struct bt_fontc_glyphs glyphs[static 1],
+                             uint32_t level) {
+  uint32_t count = glyphs->count;
+  for (uint32_t glyph = 0; glyph < count; glyph += 1) {
+    struct bt_font_curve_info const *source = &glyphs->infos[glyph];
+    struct bt_font_curve_info *info = &glyphs->infos[level * count + glyph];
+    struct bt_fontc_uints *bands = glyphs->bands;
+    if (source->band_count == 0) {
+      // The components of the level instead of their full outlines
+      uint32_t component_count = bands->data[source->band_start];
+      if (!bt_fontc_uints_reserve(bands, 1 + 2 * component_count)) {
+        return false;
+      }
+      *info = (struct bt_font_curve_info){
+          .band_start = bands->len,
+          .band_count = 0,
+      };
+      bands->data[bands->len] = component_count;
+      uint32_t const *components = &bands->data[source->band_start + 1];
+      uint32_t *out = &bands->data[bands->len + 1];
+      for (uint32_t i = 0; i < 2 * component_count; i += 2) {
+        out[i] = level * count + components[i];
+        out[i + 1] = components[i + 1];
+      }
+      bands->len += 1 + 2 * component_count;
+      continue;
+    }
+    if (source->start == source->end) {
+      *info = *source;
+      continue;
+    }
+
+    struct bt_font_metrics metrics;
+    if (!bt_fontc_simplify(&glyphs->outline, source,
+                           bt_fontc_lod_tolerances[level], info)) {
+      return false;
+    }
+    // The grid covers the simplified outline, which can be slightly off the
+    // glyph bounds. Keeping the bands of the full outline leaves fewer curves
+    // in each of them, which is what the fragment shader walks.
+    bt_fontc_compute_bounds(glyphs->outline.curves->data, info, &metrics);
+    if (!bt_fontc_build_bands(bands, glyphs->outline.curves->data, info,
+                              &metrics, source->band_count)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int bt_fontc_compare_uints(void const *a, void const *b) {
+  uint32_t value_a = *(uint32_t const *)a;
+  uint32_t value_b = *(uint32_t const *)b;
+  return (value_a > value_b) - (value_a < value_b);
+}
+
+/*
+ * Checks that the curves of every level of every glyph start exactly where
+ * they end, so that the outlines are closed and rays cross them an even
+ * number of times. Returns false if one has a gap or on fatal errors.
+ */
+static bool
+bt_fontc_check_outlines(struct bt_fontc_glyphs const glyphs[static 1]) {
+  struct bt_font_curve const *curves = glyphs->outline.curves->data;
+  uint32_t *points = nullptr;
+  bool closed = true;
+  for (uint32_t i = 0; closed && i < glyphs->count * bt_font_lod_count;
+       i += 1) {
+    struct bt_font_curve_info const *info = &glyphs->infos[i];
+    // Composite glyphs have no curves of their own
+    if (info->band_count == 0 || info->start == info->end) {
+      continue;
+    }
+    uint32_t count = info->end - info->start;
+    uint32_t *resized = realloc(points, 2 * count * sizeof(*points));
+    if (!resized) {
+      fprintf(stderr, "fontc: out of memory\n");
+      free(points);
+      return false;
+    }
+    points = resized;
+    for (uint32_t j = 0; j < count; j += 1) {
+      struct bt_font_curve const *curve = &curves[info->start + j];
+      points[j] = (uint32_t)curve->p0[1] << 16 | curve->p0[0];
+      points[count + j] = (uint32_t)curve->p2[1] << 16 | curve->p2[0];
+    }
+    qsort(points, count, sizeof(*points), bt_fontc_compare_uints);
+    qsort(&points[count], count, sizeof(*points), bt_fontc_compare_uints);
+    if (memcmp(points, &points[count], count * sizeof(*points)) != 0) {
+      fprintf(stderr, "fontc: level %u of glyph %u has a gap\n",
+              i / glyphs->count, i % glyphs->count);
+      closed = false;
+    }
+  }
+  free(points);
+  return closed;
+}
+
+/*
+ * Writes one section of the font pack, padded to the section alignment
+ */
+static bool bt_fontc_write_section(FILE *file, uint32_t magic, uint32_t count,
+                                   uint32_t element_size, void const *data) {
+  static unsigned char const padding[bt_font_pack_section_alignment] = {};
+  struct bt_font_data_header header = {
+      .magic = magic,
+      .version = bt_font_data_version,
+      .count = count,
+      .element_size = element_size,
+  };
+  size_t payload_size = (size_t)count * element_size;
+  size_t padding_size = (bt_font_pack_section_alignment -
+                         payload_size % bt_font_pack_section_alignment) %
+                        bt_font_pack_section_alignment;
+  return fwrite(&header, sizeof(header), 1, file) == 1 &&
+         (count == 0 || fwrite(data, element_size, count, file) == count) &&
+         fwrite(padding, 1, padding_size, file) == padding_size;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t max_codepoint = bt_fontc_max_codepoint;
+  char const *font_path = nullptr;
+  char const *out_path = nullptr;
+  for (int i = 1; i < argc; i += 1) {
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      i += 1;
+      max_codepoint = (uint32_t)strtoul(argv[i], nullptr, 0);
+    } else if (!font_path) {
+      font_path = argv[i];
+    } else if (!out_path) {
+      out_path = argv[i];
+    } else {
+      font_path = nullptr;
+      break;
+    }
+  }
+  if (!font_path || !out_path || max_codepoint > bt_fontc_max_codepoint) {
+    fprintf(stderr, "usage: %s [-m max_codepoint] <font file> <output pack>\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FT_Library library;
+  if (FT_Init_FreeType(&library)) {
+    fprintf(stderr, "fontc: failed to initialize FreeType\n");
+    return EXIT_FAILURE;
+  }
+
+  int result = EXIT_FAILURE;
+  struct bt_fontc_curves curves = {};
+  struct bt_fontc_uints contours = {};
+  struct bt_fontc_uints bands = {};
+  struct bt_fontc_uints cmap_buffer = {};
+  struct bt_fontc_cmap *cmap = calloc(1, sizeof(*cmap));
+  struct bt_fontc_glyphs glyphs = {.bands = &bands};
+  if (!cmap || !bt_fontc_uints_reserve(&bands, 4 + bt_font_grid_words)) {
+    fprintf(stderr, "fontc: out of memory\n");
+    goto done;
+  }
+  // Empty horizontal and vertical band shared by all glyphs without curves,
+  // and an empty occupancy grid whose min is past its max, so no pixel is
+  // inside it
+  bands.len = 4 + bt_font_grid_words;
+  for (uint32_t i = 0; i < 4; i += 1) {
+    bands.data[i] = bands.len;
+  }
+  bands.data[4] = UINT32_MAX;
+  memset(&bands.data[5], 0, (bt_font_grid_words - 1) * sizeof(*bands.data));
+
+  if (FT_New_Face(library, font_path, 0, &glyphs.face)) {
+    fprintf(stderr, "fontc: failed to open font %s\n", font_path);
+    goto done;
+  }
+  FT_Face face = glyphs.face;
+  if (!FT_IS_SCALABLE(face)) {
+    fprintf(stderr, "fontc: %s has no outlines\n", font_path);
+    goto done;
+  }
+
+  // Our glyph 0 is the empty glyph, so there can be one more than in the font
+  size_t max_glyphs = (size_t)face->num_glyphs + 1;
+  glyphs.infos = calloc(max_glyphs * bt_font_lod_count, sizeof(*glyphs.infos));
+  glyphs.metrics = calloc(max_glyphs, sizeof(*glyphs.metrics));
+  glyphs.map = calloc(max_glyphs, sizeof(*glyphs.map));
+  if (!glyphs.infos || !glyphs.metrics || !glyphs.map) {
+    fprintf(stderr, "fontc: out of memory\n");
+    goto done;
+  }
+
+  /*
+   * The unit quad of a glyph instance covers the em box horizontally with the
+   * pen position at its left edge, and the line from ascender to descender
+   * vertically. Both axes use the same scale so the outlines keep their
+   * aspect ratio.
+   */
+  float line_height = (float)(face->ascender - face->descender);
+  float em = (float)face->units_per_EM;
+  glyphs.outline = (struct bt_fontc_outline){
+      .curves = &curves,
+      .contours = &contours,
+      .scale = 1.0f / (line_height > em ? line_height : em),
+      .ascender = (float)face->ascender,
+  };
+
+  glyphs.infos[0] = (struct bt_font_curve_info){
+      .band_start = 0,
+      .band_count = 1,
+  };
+  bt_fontc_compute_bounds(curves.data, &glyphs.infos[0], &glyphs.metrics[0]);
+  glyphs.count = 1;
+  FT_UInt font_glyph = 0;
+  for (FT_ULong c = FT_Get_First_Char(face, &font_glyph);
+       font_glyph != 0 && c <= max_codepoint;
+       c = FT_Get_Next_Char(face, c, &font_glyph)) {
+    uint32_t glyph = bt_fontc_add_glyph(&glyphs, font_glyph, (uint32_t)c);
+    if (glyph == 0) {
+      goto done;
+    }
+
+    if (!bt_fontc_cmap_set(cmap, (uint32_t)c, glyph)) {
+      fprintf(stderr, "fontc: out of memory\n");
+      goto done;
+    }
+  }
+  for (uint32_t level = 1; level < bt_font_lod_count; level += 1) {
+    if (!bt_fontc_add_lod(&glyphs, level)) {
+      fprintf(stderr, "fontc: out of memory\n");
+      goto done;
+    }
+  }
+  if (!bt_fontc_check_outlines(&glyphs)) {
+    goto done;
+  }
+
+  if (!bt_fontc_cmap_serialize(cmap, &cmap_buffer)) {
+    fprintf(stderr, "fontc: out of memory\n");
+    goto done;
+  }
+
+  FILE *file = fopen(out_path, "wb");
+  if (!file) {
+    fprintf(stderr, "fontc: failed to open %s: %s\n", out_path,
+            strerror(errno));
+    goto done;
+  }
+  struct bt_font_pack_header header = {
+      .magic = bt_font_data_magic_pack,
+      .version = bt_font_data_version,
+      .section_count = bt_font_pack_section_count,
+  };
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      bt_fontc_write_section(file, bt_font_data_magic_curves, curves.len,
+                             sizeof(*curves.data), curves.data) &&
+      bt_fontc_write_section(file, bt_font_data_magic_infos,
+                             glyphs.count * bt_font_lod_count,
+                             sizeof(*glyphs.infos), glyphs.infos) &&
+      bt_fontc_write_section(file, bt_font_data_magic_metrics, glyphs.count,
+                             sizeof(*glyphs.metrics), glyphs.metrics) &&
+      bt_fontc_write_section(file, bt_font_data_magic_bands, bands.len,
+                             sizeof(*bands.data), bands.data) &&
+      bt_fontc_write_section(file, bt_font_data_magic_cmap, cmap_buffer.len,
+                             sizeof(*cmap_buffer.data), cmap_buffer.data);
+  written = fclose(file) == 0 && written;
+  if (!written) {
+    fprintf(stderr, "fontc: failed to write %s\n", out_path);
+    remove(out_path);
+    goto done;
+  }
+  result = EXIT_SUCCESS;
+
+done:
+  if (glyphs.face) {
+    FT_Done_Face(glyphs.face);
+  }
+  FT_Done_FreeType(library);
+  if (cmap) {
+    for (uint32_t i = 0; i < bt_fontc_cmap_page_count; i += 1) {
+      free(cmap->pages[i]);
+    }
+  }
+  free(cmap);
+  free(cmap_buffer.data);
+  free(curves.data);
+  free(contours.data);
+  free(bands.data);
+  free(glyphs.infos);
+  free(glyphs.metrics);
+  free(glyphs.map);
+  return result;
+}
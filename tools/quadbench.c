@@ -0,0 +1,225 @@
+/*
+ * Counts the fragments the glyph pipelines rasterize for a text, once with the
+ * whole glyph quad and once with the quad fitted to the glyph bounds as the
+ * vertex shaders do, to show how much fragment shader work the bounds save.
+ *
+ * Usage: quadbench [-s pixels_per_quad] <font pack> [text]
+ *
+ * Without a text, every glyph of the pack is counted once. Glyph quads are
+ * assumed to be axis aligned and start on a pixel boundary.
+ */
+#include "data.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+constexpr uint32_t bt_quadbench_default_size = 32;
+/*
+ * Keep in sync with the vertex shaders
+ */
+constexpr float bt_quadbench_bounds_margin = 1.0f / 32.0f;
+
+struct bt_quadbench_pack {
+  struct bt_font_metrics const *metrics;
+  uint32_t const *cmap;
+  uint32_t metrics_len;
+  uint32_t cmap_len;
+};
+
+/*
+ * Returns the elements of the section at `offset` and moves past it, or
+ * nullptr if it is invalid
+ */
+static void const *bt_quadbench_section(unsigned char const *bytes,
+                                        size_t size, size_t offset[static 1],
+                                        uint32_t magic, uint32_t element_size,
+                                        uint32_t len[static 1]) {
+  struct bt_font_data_header header;
+  if (size - *offset < sizeof(header)) {
+    return nullptr;
+  }
+  memcpy(&header, bytes + *offset, sizeof(header));
+  size_t payload_size = (size_t)header.count * element_size;
+  if (header.magic != magic || header.version != bt_font_data_version ||
+      header.element_size != element_size ||
+      size - *offset - sizeof(header) < payload_size) {
+    return nullptr;
+  }
+
+  void const *data = bytes + *offset + sizeof(header);
+  size_t aligned_size = sizeof(header) + payload_size;
+  aligned_size += (bt_font_pack_section_alignment -
+                   aligned_size % bt_font_pack_section_alignment) %
+                  bt_font_pack_section_alignment;
+  *offset = *offset + aligned_size < size ? *offset + aligned_size : size;
+  *len = header.count;
+
+  return data;
+}
+
+static bool bt_quadbench_read_pack(unsigned char const *bytes, size_t size,
+                                   struct bt_quadbench_pack pack[static 1]) {
+  struct bt_font_pack_header header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, bytes, sizeof(header));
+  if (header.magic != bt_font_data_magic_pack ||
+      header.version != bt_font_data_version ||
+      header.section_count != bt_font_pack_section_count) {
+    return false;
+  }
+
+  size_t offset = sizeof(header);
+  uint32_t len;
+  if (!bt_quadbench_section(bytes, size, &offset, bt_font_data_magic_curves,
+                            sizeof(struct bt_font_curve), &len) ||
+      !bt_quadbench_section(bytes, size, &offset, bt_font_data_magic_infos,
+                            sizeof(struct bt_font_curve_info), &len)) {
+    return false;
+  }
+  pack->metrics = bt_quadbench_section(
+      bytes, size, &offset, bt_font_data_magic_metrics,
+      sizeof(struct bt_font_metrics), &pack->metrics_len);
+  if (!pack->metrics ||
+      !bt_quadbench_section(bytes, size, &offset, bt_font_data_magic_bands,
+                            sizeof(uint32_t), &len)) {
+    return false;
+  }
+  pack->cmap = bt_quadbench_section(bytes, size, &offset,
+                                    bt_font_data_magic_cmap, sizeof(uint32_t),
+                                    &pack->cmap_len);
+  return pack->cmap && pack->cmap_len > 0 &&
+         pack->cmap_len > pack->cmap[0];
+}
+
+static uint32_t
+bt_quadbench_glyph(struct bt_quadbench_pack const pack[static 1],
+                   uint32_t codepoint) {
+  uint32_t page = codepoint >> bt_font_cmap_page_bits;
+  if (page >= pack->cmap[0]) {
+    return 0;
+  }
+  uint32_t index =
+      pack->cmap[1 + page] + (codepoint & (bt_font_cmap_page_size - 1));
+  uint32_t glyph = index < pack->cmap_len ? pack->cmap[index] : 0;
+  return glyph < pack->metrics_len ? glyph : 0;
+}
+
+/*
+ * Decodes one UTF-8 sequence, returning the number of bytes used
+ */
+static size_t bt_quadbench_decode(char const *s, uint32_t codepoint[static 1]) {
+  unsigned char c = (unsigned char)s[0];
+  size_t length = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+  *codepoint = length == 1 ? c : c & (0x7Fu >> length);
+  for (size_t i = 1; i < length; i += 1) {
+    if (((unsigned char)s[i] & 0xC0) != 0x80) {
+      *codepoint = 0xFFFD;
+      return i;
+    }
+    *codepoint = *codepoint << 6 | ((unsigned char)s[i] & 0x3F);
+  }
+  return length;
+}
+
+/*
+ * Number of pixel centers in [min, max) along an axis of a glyph quad that is
+ * `size` pixels wide
+ */
+static uint64_t bt_quadbench_pixels(float min, float max, uint32_t size) {
+  float first = ceilf(min * (float)size - 0.5f);
+  float end = ceilf(max * (float)size - 0.5f);
+  return end > first ? (uint64_t)(end - first) : 0;
+}
+
+static uint64_t
+bt_quadbench_fitted_fragments(struct bt_font_metrics const metrics[static 1],
+                              uint32_t size) {
+  float bounds[4];
+  for (int i = 0; i < 4; i += 1) {
+    bounds[i] =
+        (float)metrics->bounds[i] * bt_font_curve_step + bt_font_curve_min;
+  }
+  if (bounds[0] > bounds[2] || bounds[1] > bounds[3]) {
+    return 0;
+  }
+  return bt_quadbench_pixels(bounds[0] - bt_quadbench_bounds_margin,
+                             bounds[2] + bt_quadbench_bounds_margin, size) *
+         bt_quadbench_pixels(bounds[1] - bt_quadbench_bounds_margin,
+                             bounds[3] + bt_quadbench_bounds_margin, size);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t size = bt_quadbench_default_size;
+  char const *pack_path = nullptr;
+  char const *text = nullptr;
+  for (int i = 1; i < argc; i += 1) {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      i += 1;
+      size = (uint32_t)strtoul(argv[i], nullptr, 0);
+    } else if (!pack_path) {
+      pack_path = argv[i];
+    } else if (!text) {
+      text = argv[i];
+    } else {
+      pack_path = nullptr;
+      break;
+    }
+  }
+  if (!pack_path || size == 0) {
+    fprintf(stderr, "usage: %s [-s pixels_per_quad] <font pack> [text]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *file = fopen(pack_path, "rb");
+  if (!file) {
+    fprintf(stderr, "quadbench: failed to open %s\n", pack_path);
+    return EXIT_FAILURE;
+  }
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *bytes = file_size > 0 ? malloc((size_t)file_size) : nullptr;
+  bool read = bytes && fread(bytes, 1, (size_t)file_size, file) ==
+                           (size_t)file_size;
+  fclose(file);
+
+  struct bt_quadbench_pack pack = {};
+  if (!read || !bt_quadbench_read_pack(bytes, (size_t)file_size, &pack)) {
+    fprintf(stderr, "quadbench: %s is not a valid font pack\n", pack_path);
+    free(bytes);
+    return EXIT_FAILURE;
+  }
+
+  uint64_t glyphs = 0;
+  uint64_t full = 0;
+  uint64_t fitted = 0;
+  if (text) {
+    for (char const *p = text; *p;) {
+      uint32_t codepoint;
+      p += bt_quadbench_decode(p, &codepoint);
+      glyphs += 1;
+      full += (uint64_t)size * size;
+      fitted += bt_quadbench_fitted_fragments(
+          &pack.metrics[bt_quadbench_glyph(&pack, codepoint)], size);
+    }
+  } else {
+    for (uint32_t glyph = 0; glyph < pack.metrics_len; glyph += 1) {
+      glyphs += 1;
+      full += (uint64_t)size * size;
+      fitted += bt_quadbench_fitted_fragments(&pack.metrics[glyph], size);
+    }
+  }
+
+  printf("glyphs:           %llu\n", (unsigned long long)glyphs);
+  printf("full quads:       %llu fragments\n", (unsigned long long)full);
+  printf("fitted quads:     %llu fragments\n", (unsigned long long)fitted);
+  printf("fragments saved:  %.1f%%\n",
+         full ? 100.0 * (1.0 - (double)fitted / (double)full) : 0.0);
+
+  free(bytes);
+  return EXIT_SUCCESS;
+}